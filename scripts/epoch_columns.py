@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+
+"""
+Read the columnar epoch stats (epoch_format = columnar or both), see
+src/column_writer.h for the format.
+
+    columns = read_epoch_columns('dramsim3epoch.bin')
+    columns['average_bandwidth']  # one value per channel and epoch
+
+Columns are numpy arrays if numpy is available, array.array otherwise.
+"""
+
+import argparse
+import array
+import struct
+import sys
+
+MAGIC = b'DS3EPOCH'
+VERSION = 1
+# ColumnType -> array typecode
+TYPECODES = {0: 'Q', 1: 'q', 2: 'd'}
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+
+def read_epoch_columns(file_name):
+    """return a dict of column name -> values in file order"""
+    with open(file_name, 'rb') as f:
+        data = f.read()
+    if data[:8] != MAGIC:
+        raise ValueError(file_name + ' is not a columnar epoch stats file')
+    version, num_columns = struct.unpack_from('<II', data, 8)
+    if version != VERSION:
+        raise ValueError('unsupported version {}'.format(version))
+    pos = 16
+    schema = []
+    for _ in range(num_columns):
+        col_type, _, name_len = struct.unpack_from('<BBH', data, pos)
+        pos += 4
+        name = data[pos:pos + name_len].decode()
+        pos += name_len
+        schema.append((name, TYPECODES[col_type]))
+
+    columns = {name: array.array(code) for name, code in schema}
+    while pos < len(data):
+        num_rows, _ = struct.unpack_from('<II', data, pos)
+        pos += 8
+        for name, _ in schema:
+            end = pos + 8 * num_rows
+            columns[name].frombytes(data[pos:end])
+            pos = end
+    if sys.byteorder != 'little':
+        for values in columns.values():
+            values.byteswap()
+    if numpy is not None:
+        return {name: numpy.asarray(values)
+                for name, values in columns.items()}
+    return columns
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Read columnar epoch stats '
+                                     'and print them or write them as CSV')
+    parser.add_argument('file', help='epoch stats file, e.g. dramsim3epoch.bin')
+    parser.add_argument('-c', '--csv', help='write all columns to this CSV')
+    parser.add_argument('-k', '--key', action='append',
+                        help='only these columns, can be repeated')
+    args = parser.parse_args()
+
+    columns = read_epoch_columns(args.file)
+    names = args.key if args.key else list(columns)
+    if args.csv:
+        with open(args.csv, 'w') as out:
+            out.write(','.join(names) + '\n')
+            for row in zip(*(columns[name] for name in names)):
+                out.write(','.join(str(value) for value in row) + '\n')
+    else:
+        for name in names:
+            print(name, list(columns[name]))
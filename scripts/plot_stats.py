@@ -115,7 +115,11 @@ if __name__ == '__main__':
     with open(args.json, 'r') as j_file:
         is_epoch = False
         try:
-            j_data = json.load(j_file)
+            if args.json.endswith('.jsonl'):
+                # epoch stats, one JSON object per line
+                j_data = [json.loads(line) for line in j_file if line.strip()]
+            else:
+                j_data = json.load(j_file)
         except:
             print('cannot load file ' + args.json)
             exit(1)
@@ -0,0 +1,80 @@
+#ifndef __ACTIVATION_WINDOW_H
+#define __ACTIVATION_WINDOW_H
+
+#include <cstdint>
+#include <vector>
+#include "checkpoint.h"
+
+namespace dramsim3 {
+
+// Rolling activation budget of a rank: at most max_acts ACTIVATEs in any
+// window of window_cycles, e.g. tFAW (4 per tFAW) or GDDR's t32AW. The
+// expiry times of the recorded activations live in a ring buffer of
+// max_acts entries allocated once, so checks and updates are O(1).
+class ActivationWindow {
+   public:
+    ActivationWindow(int max_acts, int window_cycles)
+        : window_cycles_(window_cycles),
+          expiry_(max_acts > 0 ? max_acts : 1),
+          head_(0),
+          size_(0) {}
+
+    bool IsReady(uint64_t curr_time) const {
+        return !IsFull() || curr_time >= expiry_[head_];
+    }
+
+    // earliest cycle another activation fits, 0 if it fits right away
+    uint64_t ReadyCycle() const { return IsFull() ? expiry_[head_] : 0; }
+
+    void Record(uint64_t curr_time) {
+        // retire at most the oldest activation, an activation is only
+        // issued while IsReady() so that keeps the buffer from overflowing
+        if (size_ > 0 && (curr_time >= expiry_[head_] || IsFull())) {
+            head_ = Next(head_);
+            size_--;
+        }
+        size_t tail = head_ + size_;
+        if (tail >= expiry_.size()) {
+            tail -= expiry_.size();
+        }
+        expiry_[tail] = curr_time + window_cycles_;
+        size_++;
+    }
+
+    void SaveState(CheckpointWriter& ckpt) const {
+        ckpt.Put(expiry_);
+        ckpt.Put(static_cast<uint64_t>(head_));
+        ckpt.Put(static_cast<uint64_t>(size_));
+    }
+
+    void RestoreState(CheckpointReader& ckpt) {
+        ckpt.ExpectSize(expiry_.size());
+        for (auto& expiry : expiry_) {
+            ckpt.Get(expiry);
+        }
+        uint64_t head, size;
+        ckpt.Get(head);
+        ckpt.Get(size);
+        if (head >= expiry_.size() || size > expiry_.size()) {
+            ckpt.Fail();
+            head = 0;
+            size = 0;
+        }
+        head_ = head;
+        size_ = size;
+    }
+
+   private:
+    int window_cycles_;
+    std::vector<uint64_t> expiry_;
+    size_t head_;
+    size_t size_;
+
+    bool IsFull() const { return size_ >= expiry_.size(); }
+    size_t Next(size_t idx) const {
+        return idx + 1 == expiry_.size() ? 0 : idx + 1;
+    }
+};
+
+}  // namespace dramsim3
+#endif
@@ -2,6 +2,7 @@
 #define __BANKSTATE_H
 
 #include <vector>
+#include "checkpoint.h"
 #include "common.h"
 
 namespace dramsim3 {
@@ -11,26 +12,26 @@ class BankState {
     BankState();
 
     enum class State { OPEN, CLOSED, SREF, PD, SIZE };
-    Command GetReadyCommand(const Command& cmd, uint64_t clk) const;
+
+    // The command that has to be issued to this bank before cmd can proceed
+    // (cmd's own type if nothing else is required)
+    CommandType GetRequiredCommandType(const Command& cmd) const;
 
     // Update the state of the bank resulting after the execution of the command
     void UpdateState(const Command& cmd);
 
-    // Update the existing timing constraints for the command
-    void UpdateTiming(const CommandType cmd_type, uint64_t time);
-
     bool IsRowOpen() const { return state_ == State::OPEN; }
     int OpenRow() const { return open_row_; }
     int RowHitCount() const { return row_hit_count_; }
 
+    void SaveState(CheckpointWriter& ckpt) const;
+    void RestoreState(CheckpointReader& ckpt);
+
    private:
     // Current state of the Bank
     // Apriori or instantaneously transitions on a command.
     State state_;
 
-    // Earliest time when the particular Command can be executed in this bank
-    std::vector<uint64_t> cmd_timing_;
-
     // Currently open row
     int open_row_;
 
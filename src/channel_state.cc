@@ -1,32 +1,80 @@
 #include "channel_state.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "profiler.h"
+
 namespace dramsim3 {
 ChannelState::ChannelState(const Config& config, const Timing& timing)
     : rank_idle_cycles(config.ranks, 0),
       config_(config),
       timing_(timing),
       rank_is_sref_(config.ranks, false),
-      four_aw_(config_.ranks, std::vector<uint64_t>()),
-      thirty_two_aw_(config_.ranks, std::vector<uint64_t>()) {
-    bank_states_.reserve(config_.ranks);
-    for (auto i = 0; i < config_.ranks; i++) {
-        auto rank_states = std::vector<std::vector<BankState>>();
-        rank_states.reserve(config_.bankgroups);
-        for (auto j = 0; j < config_.bankgroups; j++) {
-            auto bg_states =
-                std::vector<BankState>(config_.banks_per_group, BankState());
-            rank_states.push_back(bg_states);
+      bank_states_(config.ranks * config.banks, BankState()),
+      activation_windows_(config.ranks) {
+    for (auto& windows : activation_windows_) {
+        windows.emplace_back(4, config_.tFAW);
+        if (config_.IsGDDR()) {
+            windows.emplace_back(32, config_.t32AW);
         }
-        bank_states_.push_back(rank_states);
     }
+    const size_t slots_per_line = kCacheLine / sizeof(uint64_t);
+    timing_storage_.resize(bank_states_.size() * kCmdStride + slots_per_line,
+                           0);
+    uintptr_t base = reinterpret_cast<uintptr_t>(timing_storage_.data());
+    timing_offset_ = ((kCacheLine - base % kCacheLine) % kCacheLine) /
+                     sizeof(uint64_t);
+    InitConstraintRows();
 }
 
-bool ChannelState::IsAllBankIdleInRank(int rank) const {
-    for (int j = 0; j < config_.bankgroups; j++) {
-        for (int k = 0; k < config_.banks_per_group; k++) {
-            if (bank_states_[rank][j][k].IsRowOpen()) {
-                return false;
+void ChannelState::InitConstraintRows() {
+    const std::vector<std::vector<std::pair<CommandType, int> > >*
+        lists[NUM_SCOPES];
+    lists[SAME_BANK] = &timing_.same_bank;
+    lists[OTHER_BANKS_SAME_BANKGROUP] = &timing_.other_banks_same_bankgroup;
+    lists[OTHER_BANKGROUPS_SAME_RANK] = &timing_.other_bankgroups_same_rank;
+    lists[OTHER_RANKS] = &timing_.other_ranks;
+    lists[SAME_RANK] = &timing_.same_rank;
+
+    const int num_cmds = static_cast<int>(CommandType::SIZE);
+    constraint_rows_.assign(NUM_SCOPES * num_cmds * kCmdStride, 0);
+    row_kernels_.assign(NUM_SCOPES * num_cmds, nullptr);
+    for (int scope = 0; scope < NUM_SCOPES; scope++) {
+        for (int cmd = 0; cmd < num_cmds; cmd++) {
+            const auto& cmd_timing_list = (*lists[scope])[cmd];
+            if (cmd_timing_list.empty()) {
+                continue;
             }
+            // several entries for one command type collapse into the largest
+            std::vector<int64_t> delays(kCmdStride,
+                                        std::numeric_limits<int64_t>::min());
+            for (const auto& cmd_timing : cmd_timing_list) {
+                int64_t& delay = delays[static_cast<int>(cmd_timing.first)];
+                delay =
+                    std::max(delay, static_cast<int64_t>(cmd_timing.second));
+            }
+            int row = scope * num_cmds + cmd;
+            int lanes = 0;
+            for (int i = 0; i < kCmdStride; i++) {
+                if (delays[i] != std::numeric_limits<int64_t>::min()) {
+                    // added to the clock in uint64_t like the lists always were
+                    constraint_rows_[row * kCmdStride + i] =
+                        static_cast<uint64_t>(delays[i]);
+                    lanes = i + 1;
+                }
+            }
+            row_kernels_[row] = SelectMaxRowsKernel(lanes);
+        }
+    }
+}
+
+bool ChannelState::IsAllBankIdleInRank(int rank) const {
+    int first_bank = BankIndex(rank, 0, 0);
+    for (int b = first_bank; b < first_bank + config_.banks; b++) {
+        if (bank_states_[b].IsRowOpen()) {
+            return false;
         }
     }
     return true;
@@ -38,7 +86,7 @@ bool ChannelState::IsRWPendingOnRef(const Command& cmd) const {
     int bank = cmd.Bank();
     return (IsRowOpen(rank, bankgroup, bank) &&
             RowHitCount(rank, bankgroup, bank) == 0 &&
-            bank_states_[rank][bankgroup][bank].OpenRow() == cmd.Row());
+            OpenRow(rank, bankgroup, bank) == cmd.Row());
 }
 
 void ChannelState::BankNeedRefresh(int rank, int bankgroup, int bank,
@@ -73,14 +121,26 @@ void ChannelState::RankNeedRefresh(int rank, bool need) {
     return;
 }
 
+Command ChannelState::GetBankReadyCommand(int bank_idx, const Command& cmd,
+                                          uint64_t clk) const {
+    CommandType required_type =
+        bank_states_[bank_idx].GetRequiredCommandType(cmd);
+    if (required_type != CommandType::SIZE) {
+        if (clk >= BankTiming(bank_idx)[static_cast<int>(required_type)]) {
+            return Command(required_type, cmd.addr, cmd.hex_addr);
+        }
+    }
+    return Command();
+}
+
 Command ChannelState::GetReadyCommand(const Command& cmd, uint64_t clk) const {
     Command ready_cmd = Command();
     if (cmd.IsRankCMD()) {
         int num_ready = 0;
         for (auto j = 0; j < config_.bankgroups; j++) {
             for (auto k = 0; k < config_.banks_per_group; k++) {
-                ready_cmd =
-                    bank_states_[cmd.Rank()][j][k].GetReadyCommand(cmd, clk);
+                ready_cmd = GetBankReadyCommand(BankIndex(cmd.Rank(), j, k),
+                                                cmd, clk);
                 if (!ready_cmd.IsValid()) {  // Not ready
                     continue;
                 }
@@ -100,8 +160,8 @@ Command ChannelState::GetReadyCommand(const Command& cmd, uint64_t clk) const {
             return Command();
         }
     } else {
-        ready_cmd = bank_states_[cmd.Rank()][cmd.Bankgroup()][cmd.Bank()]
-                        .GetReadyCommand(cmd, clk);
+        ready_cmd = GetBankReadyCommand(
+            BankIndex(cmd.Rank(), cmd.Bankgroup(), cmd.Bank()), cmd, clk);
         if (!ready_cmd.IsValid()) {
             return Command();
         }
@@ -114,12 +174,26 @@ Command ChannelState::GetReadyCommand(const Command& cmd, uint64_t clk) const {
     }
 }
 
+uint64_t ChannelState::GetReadyCycle(const Command& cmd) const {
+    int bank_idx = BankIndex(cmd.Rank(), cmd.Bankgroup(), cmd.Bank());
+    auto required_type = bank_states_[bank_idx].GetRequiredCommandType(cmd);
+    if (required_type == CommandType::SIZE) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    uint64_t ready_cycle =
+        BankTiming(bank_idx)[static_cast<int>(required_type)];
+    if (required_type == CommandType::ACTIVATE) {
+        ready_cycle =
+            std::max(ready_cycle, ActivationWindowReadyCycle(cmd.Rank()));
+    }
+    return ready_cycle;
+}
+
 void ChannelState::UpdateState(const Command& cmd) {
     if (cmd.IsRankCMD()) {
-        for (auto j = 0; j < config_.bankgroups; j++) {
-            for (auto k = 0; k < config_.banks_per_group; k++) {
-                bank_states_[cmd.Rank()][j][k].UpdateState(cmd);
-            }
+        int first_bank = BankIndex(cmd.Rank(), 0, 0);
+        for (int b = first_bank; b < first_bank + config_.banks; b++) {
+            bank_states_[b].UpdateState(cmd);
         }
         if (cmd.IsRefresh()) {
             RankNeedRefresh(cmd.Rank(), false);
@@ -129,7 +203,8 @@ void ChannelState::UpdateState(const Command& cmd) {
             rank_is_sref_[cmd.Rank()] = false;
         }
     } else {
-        bank_states_[cmd.Rank()][cmd.Bankgroup()][cmd.Bank()].UpdateState(cmd);
+        bank_states_[BankIndex(cmd.Rank(), cmd.Bankgroup(), cmd.Bank())]
+            .UpdateState(cmd);
         if (cmd.IsRefresh()) {
             BankNeedRefresh(cmd.Rank(), cmd.Bankgroup(), cmd.Bank(), false);
         }
@@ -137,7 +212,32 @@ void ChannelState::UpdateState(const Command& cmd) {
     return;
 }
 
+void ChannelState::FunctionalUpdate(const Command& cmd) {
+    if (cmd.IsRankCMD()) {
+        // a rank refresh needs every bank closed, not just one
+        int first_bank = BankIndex(cmd.Rank(), 0, 0);
+        for (int b = first_bank; b < first_bank + config_.banks; b++) {
+            if (bank_states_[b].IsRowOpen()) {
+                bank_states_[b].UpdateState(
+                    Command(CommandType::PRECHARGE, cmd.addr, cmd.hex_addr));
+            }
+        }
+    } else {
+        const BankState& bank_state =
+            bank_states_[BankIndex(cmd.Rank(), cmd.Bankgroup(), cmd.Bank())];
+        CommandType required_type = bank_state.GetRequiredCommandType(cmd);
+        while (required_type != cmd.cmd_type) {
+            UpdateState(Command(required_type, cmd.addr, cmd.hex_addr));
+            required_type = bank_state.GetRequiredCommandType(cmd);
+        }
+    }
+    UpdateState(cmd);
+}
+
 void ChannelState::UpdateTiming(const Command& cmd, uint64_t clk) {
+    PROFILE_SCOPE(UPDATE_TIMING);
+    int rank_first = BankIndex(cmd.Rank(), 0, 0);
+    int rank_last = rank_first + config_.banks;
     switch (cmd.cmd_type) {
         case CommandType::ACTIVATE:
             UpdateActivationTimes(cmd.Rank(), clk);
@@ -146,38 +246,35 @@ void ChannelState::UpdateTiming(const Command& cmd, uint64_t clk) {
         case CommandType::WRITE:
         case CommandType::WRITE_PRECHARGE:
         case CommandType::PRECHARGE:
-        case CommandType::REFRESH_BANK:
-            // TODO - simulator speed? - Speciazlize which of the below
-            // functions to call depending on the command type  Same Bank
-            UpdateSameBankTiming(
-                cmd.addr, timing_.same_bank[static_cast<int>(cmd.cmd_type)],
-                clk);
+        case CommandType::REFRESH_BANK: {
+            // the banks of a rank and of a bankgroup are contiguous, so each
+            // scope is at most two runs of banks around the issuing one
+            int bank = BankIndex(cmd.Rank(), cmd.Bankgroup(), cmd.Bank());
+            int bg_first = BankIndex(cmd.Rank(), cmd.Bankgroup(), 0);
+            int bg_last = bg_first + config_.banks_per_group;
+            CommandType cmd_type = cmd.cmd_type;
+            UpdateBanksTiming(bank, bank + 1, SAME_BANK, cmd_type, clk);
 
-            // Same Bankgroup other banks
-            UpdateOtherBanksSameBankgroupTiming(
-                cmd.addr,
-                timing_
-                    .other_banks_same_bankgroup[static_cast<int>(cmd.cmd_type)],
-                clk);
+            UpdateBanksTiming(bg_first, bank, OTHER_BANKS_SAME_BANKGROUP,
+                              cmd_type, clk);
+            UpdateBanksTiming(bank + 1, bg_last, OTHER_BANKS_SAME_BANKGROUP,
+                              cmd_type, clk);
 
-            // Other bankgroups
-            UpdateOtherBankgroupsSameRankTiming(
-                cmd.addr,
-                timing_
-                    .other_bankgroups_same_rank[static_cast<int>(cmd.cmd_type)],
-                clk);
+            UpdateBanksTiming(rank_first, bg_first, OTHER_BANKGROUPS_SAME_RANK,
+                              cmd_type, clk);
+            UpdateBanksTiming(bg_last, rank_last, OTHER_BANKGROUPS_SAME_RANK,
+                              cmd_type, clk);
 
-            // Other ranks
-            UpdateOtherRanksTiming(
-                cmd.addr, timing_.other_ranks[static_cast<int>(cmd.cmd_type)],
-                clk);
+            UpdateBanksTiming(0, rank_first, OTHER_RANKS, cmd_type, clk);
+            UpdateBanksTiming(rank_last, static_cast<int>(bank_states_.size()),
+                              OTHER_RANKS, cmd_type, clk);
             break;
+        }
         case CommandType::REFRESH:
         case CommandType::SREF_ENTER:
         case CommandType::SREF_EXIT:
-            UpdateSameRankTiming(
-                cmd.addr, timing_.same_rank[static_cast<int>(cmd.cmd_type)],
-                clk);
+            UpdateBanksTiming(rank_first, rank_last, SAME_RANK, cmd.cmd_type,
+                              clk);
             break;
         default:
             AbruptExit(__FILE__, __LINE__);
@@ -185,80 +282,21 @@ void ChannelState::UpdateTiming(const Command& cmd, uint64_t clk) {
     return;
 }
 
-void ChannelState::UpdateSameBankTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto cmd_timing : cmd_timing_list) {
-        bank_states_[addr.rank][addr.bankgroup][addr.bank].UpdateTiming(
-            cmd_timing.first, clk + cmd_timing.second);
-    }
-    return;
-}
-
-void ChannelState::UpdateOtherBanksSameBankgroupTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto k = 0; k < config_.banks_per_group; k++) {
-        if (k != addr.bank) {
-            for (auto cmd_timing : cmd_timing_list) {
-                bank_states_[addr.rank][addr.bankgroup][k].UpdateTiming(
-                    cmd_timing.first, clk + cmd_timing.second);
-            }
-        }
-    }
-    return;
-}
-
-void ChannelState::UpdateOtherBankgroupsSameRankTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto j = 0; j < config_.bankgroups; j++) {
-        if (j != addr.bankgroup) {
-            for (auto k = 0; k < config_.banks_per_group; k++) {
-                for (auto cmd_timing : cmd_timing_list) {
-                    bank_states_[addr.rank][j][k].UpdateTiming(
-                        cmd_timing.first, clk + cmd_timing.second);
-                }
-            }
-        }
+void ChannelState::UpdateBanksTiming(int first_bank, int last_bank,
+                                     TimingScope scope, CommandType cmd_type,
+                                     uint64_t clk) {
+    int row = scope * static_cast<int>(CommandType::SIZE) +
+              static_cast<int>(cmd_type);
+    MaxRowsKernel kernel = row_kernels_[row];
+    if (kernel == nullptr || first_bank >= last_bank) {
+        return;
     }
-    return;
-}
-
-void ChannelState::UpdateOtherRanksTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto i = 0; i < config_.ranks; i++) {
-        if (i != addr.rank) {
-            for (auto j = 0; j < config_.bankgroups; j++) {
-                for (auto k = 0; k < config_.banks_per_group; k++) {
-                    for (auto cmd_timing : cmd_timing_list) {
-                        bank_states_[i][j][k].UpdateTiming(
-                            cmd_timing.first, clk + cmd_timing.second);
-                    }
-                }
-            }
-        }
-    }
-    return;
-}
-
-void ChannelState::UpdateSameRankTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto j = 0; j < config_.bankgroups; j++) {
-        for (auto k = 0; k < config_.banks_per_group; k++) {
-            for (auto cmd_timing : cmd_timing_list) {
-                bank_states_[addr.rank][j][k].UpdateTiming(
-                    cmd_timing.first, clk + cmd_timing.second);
-            }
-        }
+    const uint64_t* delays = constraint_rows_.data() + row * kCmdStride;
+    uint64_t deadline[kCmdStride];
+    for (int i = 0; i < kCmdStride; i++) {
+        deadline[i] = clk + delays[i];
     }
+    kernel(BankTiming(first_bank), last_bank - first_bank, deadline);
     return;
 }
 
@@ -269,48 +307,83 @@ void ChannelState::UpdateTimingAndStates(const Command& cmd, uint64_t clk) {
 }
 
 bool ChannelState::ActivationWindowOk(int rank, uint64_t curr_time) const {
-    bool tfaw_ok = IsFAWReady(rank, curr_time);
-    if (config_.IsGDDR()) {
-        if (!tfaw_ok)
+    for (const auto& window : activation_windows_[rank]) {
+        if (!window.IsReady(curr_time)) {
             return false;
-        else
-            return Is32AWReady(rank, curr_time);
+        }
     }
-    return tfaw_ok;
+    return true;
 }
 
 void ChannelState::UpdateActivationTimes(int rank, uint64_t curr_time) {
-    if (!four_aw_[rank].empty() && curr_time >= four_aw_[rank][0]) {
-        four_aw_[rank].erase(four_aw_[rank].begin());
-    }
-    four_aw_[rank].push_back(curr_time + config_.tFAW);
-    if (config_.IsGDDR()) {
-        if (!thirty_two_aw_[rank].empty() &&
-            curr_time >= thirty_two_aw_[rank][0]) {
-            thirty_two_aw_[rank].erase(thirty_two_aw_[rank].begin());
-        }
-        thirty_two_aw_[rank].push_back(curr_time + config_.t32AW);
+    for (auto& window : activation_windows_[rank]) {
+        window.Record(curr_time);
     }
     return;
 }
 
-bool ChannelState::IsFAWReady(int rank, uint64_t curr_time) const {
-    if (!four_aw_[rank].empty()) {
-        if (curr_time < four_aw_[rank][0] && four_aw_[rank].size() >= 4) {
-            return false;
+uint64_t ChannelState::ActivationWindowReadyCycle(int rank) const {
+    uint64_t ready_cycle = 0;
+    for (const auto& window : activation_windows_[rank]) {
+        ready_cycle = std::max(ready_cycle, window.ReadyCycle());
+    }
+    return ready_cycle;
+}
+
+void ChannelState::SaveState(CheckpointWriter& ckpt) const {
+    ckpt.Put(rank_idle_cycles);
+    ckpt.Put(rank_is_sref_);
+    ckpt.Put(static_cast<uint64_t>(bank_states_.size()));
+    for (const auto& bank_state : bank_states_) {
+        bank_state.SaveState(ckpt);
+    }
+    ckpt.Put(refresh_q_);
+    // only the aligned part, the offset depends on where it was allocated
+    const uint64_t* timing = BankTiming(0);
+    size_t num_slots = bank_states_.size() * kCmdStride;
+    ckpt.Put(static_cast<uint64_t>(num_slots));
+    for (size_t i = 0; i < num_slots; i++) {
+        ckpt.Put(timing[i]);
+    }
+    ckpt.Put(static_cast<uint64_t>(activation_windows_.size()));
+    for (const auto& windows : activation_windows_) {
+        ckpt.Put(static_cast<uint64_t>(windows.size()));
+        for (const auto& window : windows) {
+            window.SaveState(ckpt);
         }
     }
-    return true;
 }
 
-bool ChannelState::Is32AWReady(int rank, uint64_t curr_time) const {
-    if (!thirty_two_aw_[rank].empty()) {
-        if (curr_time < thirty_two_aw_[rank][0] &&
-            thirty_two_aw_[rank].size() >= 32) {
-            return false;
+void ChannelState::RestoreState(CheckpointReader& ckpt) {
+    ckpt.ExpectSize(rank_idle_cycles.size());
+    for (auto& idle_cycles : rank_idle_cycles) {
+        ckpt.Get(idle_cycles);
+    }
+    std::vector<bool> rank_is_sref;
+    ckpt.Get(rank_is_sref);
+    if (rank_is_sref.size() != rank_is_sref_.size()) {
+        ckpt.Fail();
+        return;
+    }
+    rank_is_sref_ = rank_is_sref;
+    ckpt.ExpectSize(bank_states_.size());
+    for (auto& bank_state : bank_states_) {
+        bank_state.RestoreState(ckpt);
+    }
+    ckpt.Get(refresh_q_);
+    uint64_t* timing = BankTiming(0);
+    size_t num_slots = bank_states_.size() * kCmdStride;
+    ckpt.ExpectSize(num_slots);
+    for (size_t i = 0; i < num_slots; i++) {
+        ckpt.Get(timing[i]);
+    }
+    ckpt.ExpectSize(activation_windows_.size());
+    for (auto& windows : activation_windows_) {
+        ckpt.ExpectSize(windows.size());
+        for (auto& window : windows) {
+            window.RestoreState(ckpt);
         }
     }
-    return true;
 }
 
 }  // namespace dramsim3
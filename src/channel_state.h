@@ -1,11 +1,16 @@
 #ifndef __CHANNEL_STATE_H
 #define __CHANNEL_STATE_H
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
+#include "activation_window.h"
 #include "bankstate.h"
+#include "checkpoint.h"
 #include "common.h"
 #include "configuration.h"
 #include "timing.h"
+#include "timing_kernels.h"
 
 namespace dramsim3 {
 
@@ -16,10 +21,17 @@ class ChannelState {
     void UpdateState(const Command& cmd);
     void UpdateTiming(const Command& cmd, uint64_t clk);
     void UpdateTimingAndStates(const Command& cmd, uint64_t clk);
+    // Functional fast-forward: take the banks of cmd through the states cmd
+    // and the commands it needs first would, without any timing
+    void FunctionalUpdate(const Command& cmd);
+    // Earliest cycle GetReadyCommand could return a valid command for a bank
+    // level cmd, assuming no other command is issued in the meantime
+    uint64_t GetReadyCycle(const Command& cmd) const;
     bool ActivationWindowOk(int rank, uint64_t curr_time) const;
+    uint64_t ActivationWindowReadyCycle(int rank) const;
     void UpdateActivationTimes(int rank, uint64_t curr_time);
     bool IsRowOpen(int rank, int bankgroup, int bank) const {
-        return bank_states_[rank][bankgroup][bank].IsRowOpen();
+        return bank_states_[BankIndex(rank, bankgroup, bank)].IsRowOpen();
     }
     bool IsAllBankIdleInRank(int rank) const;
     bool IsRankSelfRefreshing(int rank) const { return rank_is_sref_[rank]; }
@@ -29,56 +41,80 @@ class ChannelState {
     void BankNeedRefresh(int rank, int bankgroup, int bank, bool need);
     void RankNeedRefresh(int rank, bool need);
     int OpenRow(int rank, int bankgroup, int bank) const {
-        return bank_states_[rank][bankgroup][bank].OpenRow();
+        return bank_states_[BankIndex(rank, bankgroup, bank)].OpenRow();
     }
     int RowHitCount(int rank, int bankgroup, int bank) const {
-        return bank_states_[rank][bankgroup][bank].RowHitCount();
+        return bank_states_[BankIndex(rank, bankgroup, bank)].RowHitCount();
     };
+    // bank states, pending refreshes, the timing table and activation
+    // windows, the constraint rows are rebuilt from the timing instead
+    void SaveState(CheckpointWriter& ckpt) const;
+    void RestoreState(CheckpointReader& ckpt);
 
     std::vector<int> rank_idle_cycles;
 
    private:
+    // slots per bank in the timing table, CommandType::SIZE rounded up so
+    // that every bank starts on a cache line
+    static const int kCmdStride = kTimingRowSize;
+    static const int kCacheLine = 64;
+    enum TimingScope {
+        SAME_BANK,
+        OTHER_BANKS_SAME_BANKGROUP,
+        OTHER_BANKGROUPS_SAME_RANK,
+        OTHER_RANKS,
+        SAME_RANK,
+        NUM_SCOPES
+    };
+
     const Config& config_;
     const Timing& timing_;
 
     std::vector<bool> rank_is_sref_;
-    std::vector<std::vector<std::vector<BankState> > > bank_states_;
+    // bank level state machines, indexed by BankIndex()
+    std::vector<BankState> bank_states_;
     std::vector<Command> refresh_q_;
 
-    std::vector<std::vector<uint64_t> > four_aw_;
-    std::vector<std::vector<uint64_t> > thirty_two_aw_;
-    bool IsFAWReady(int rank, uint64_t curr_time) const;
-    bool Is32AWReady(int rank, uint64_t curr_time) const;
-    // Update timing of the bank the command corresponds to
-    void UpdateSameBankTiming(
-        const Address& addr,
-        const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
+    // Earliest cycle each command type can be issued to each bank, one
+    // contiguous array indexed [rank][bankgroup][bank][cmd] with kCmdStride
+    // slots per bank. timing_offset_ is where the cache line aligned part of
+    // timing_storage_ starts.
+    std::vector<uint64_t> timing_storage_;
+    size_t timing_offset_;
 
-    // Update timing of the other banks in the same bankgroup as the command
-    void UpdateOtherBanksSameBankgroupTiming(
-        const Address& addr,
-        const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
+    // Timing lists expanded into dense rows of kCmdStride delays indexed
+    // [scope][issued cmd][cmd], a command type without a constraint has a
+    // delay of 0 which leaves the table unchanged for any later cycle.
+    // The shape of a list is fixed by the protocol, so each row gets the
+    // kernel instance that only covers the slots up to its last constrained
+    // command type, nullptr if the list is empty.
+    std::vector<uint64_t> constraint_rows_;
+    std::vector<MaxRowsKernel> row_kernels_;
 
-    // Update timing of banks in the same rank but different bankgroup as the
-    // command
-    void UpdateOtherBankgroupsSameRankTiming(
-        const Address& addr,
-        const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
+    // rolling activation budgets every rank has to stay within, tFAW and
+    // for GDDR also t32AW
+    std::vector<std::vector<ActivationWindow> > activation_windows_;
 
-    // Update timing of banks in a different rank as the command
-    void UpdateOtherRanksTiming(
-        const Address& addr,
-        const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
+    int BankIndex(int rank, int bankgroup, int bank) const {
+        return (rank * config_.bankgroups + bankgroup) *
+                   config_.banks_per_group +
+               bank;
+    }
+    uint64_t* BankTiming(int bank_idx) {
+        return timing_storage_.data() + timing_offset_ + bank_idx * kCmdStride;
+    }
+    const uint64_t* BankTiming(int bank_idx) const {
+        return timing_storage_.data() + timing_offset_ + bank_idx * kCmdStride;
+    }
+    void InitConstraintRows();
+    Command GetBankReadyCommand(int bank_idx, const Command& cmd,
+                                uint64_t clk) const;
 
-    // Update timing of the entire rank (for rank level commands)
-    void UpdateSameRankTiming(
-        const Address& addr,
-        const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
+    // Raise the timing of banks [first_bank, last_bank) to at least clk plus
+    // the delays of the constraint row of cmd_type in scope, the banks are
+    // contiguous in the table so this is one SIMD max kernel call
+    void UpdateBanksTiming(int first_bank, int last_bank, TimingScope scope,
+                           CommandType cmd_type, uint64_t clk);
 };
 
 }  // namespace dramsim3
@@ -0,0 +1,171 @@
+#include "checkpoint.h"
+
+#include <algorithm>
+
+namespace dramsim3 {
+
+namespace {
+// no vector in a snapshot gets anywhere near this, a larger size means the
+// file is corrupt and should not be allocated for
+const uint64_t kMaxVectorSize = 1ull << 28;
+}  // namespace
+
+void CheckpointWriter::Put(uint64_t value) {
+    char bytes[10];
+    size_t size = 0;
+    while (value >= 0x80) {
+        bytes[size++] = static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    bytes[size++] = static_cast<char>(value);
+    out_.write(bytes, size);
+}
+
+void CheckpointWriter::Put(int64_t value) {
+    Put((static_cast<uint64_t>(value) << 1) ^
+        static_cast<uint64_t>(value >> 63));
+}
+
+void CheckpointWriter::Put(const Command& cmd) {
+    Put(static_cast<int>(cmd.cmd_type));
+    Put(cmd.addr.channel);
+    Put(cmd.addr.rank);
+    Put(cmd.addr.bankgroup);
+    Put(cmd.addr.bank);
+    Put(cmd.addr.row);
+    Put(cmd.addr.column);
+    Put(cmd.hex_addr);
+}
+
+void CheckpointWriter::Put(const Transaction& trans) {
+    Put(trans.addr);
+    Put(trans.added_cycle);
+    Put(trans.complete_cycle);
+    Put(trans.tag);
+    Put(trans.is_write);
+}
+
+void CheckpointWriter::Put(const MemoryRequest& req) {
+    Put(req.addr);
+    Put(req.is_write);
+    Put(req.tag);
+}
+
+void CheckpointWriter::Put(const std::vector<bool>& values) {
+    Put(static_cast<uint64_t>(values.size()));
+    for (size_t i = 0; i < values.size(); i++) {
+        Put(static_cast<bool>(values[i]));
+    }
+}
+
+void CheckpointReader::Get(uint64_t& value) {
+    value = 0;
+    int shift = 0;
+    while (ok_) {
+        int byte = in_.get();
+        if (byte == std::char_traits<char>::eof() || shift > 63) {
+            ok_ = false;
+            value = 0;
+            break;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+        shift += 7;
+    }
+}
+
+void CheckpointReader::Get(int64_t& value) {
+    uint64_t zigzag;
+    Get(zigzag);
+    value = static_cast<int64_t>(zigzag >> 1) ^
+            -static_cast<int64_t>(zigzag & 1);
+}
+
+void CheckpointReader::Get(uint32_t& value) {
+    uint64_t value64;
+    Get(value64);
+    value = static_cast<uint32_t>(value64);
+}
+
+void CheckpointReader::Get(int& value) {
+    int64_t value64;
+    Get(value64);
+    value = static_cast<int>(value64);
+}
+
+void CheckpointReader::Get(bool& value) {
+    uint64_t value64;
+    Get(value64);
+    value = value64 != 0;
+}
+
+void CheckpointReader::Get(Command& cmd) {
+    int cmd_type;
+    Get(cmd_type);
+    if (cmd_type < 0 || cmd_type > static_cast<int>(CommandType::SIZE)) {
+        ok_ = false;
+        cmd_type = static_cast<int>(CommandType::SIZE);
+    }
+    cmd.cmd_type = static_cast<CommandType>(cmd_type);
+    Get(cmd.addr.channel);
+    Get(cmd.addr.rank);
+    Get(cmd.addr.bankgroup);
+    Get(cmd.addr.bank);
+    Get(cmd.addr.row);
+    Get(cmd.addr.column);
+    Get(cmd.hex_addr);
+}
+
+void CheckpointReader::Get(Transaction& trans) {
+    Get(trans.addr);
+    Get(trans.added_cycle);
+    Get(trans.complete_cycle);
+    Get(trans.tag);
+    Get(trans.is_write);
+}
+
+void CheckpointReader::Get(MemoryRequest& req) {
+    Get(req.addr);
+    Get(req.is_write);
+    Get(req.tag);
+}
+
+void CheckpointReader::Get(std::vector<bool>& values) {
+    values.resize(GetSize());
+    for (size_t i = 0; i < values.size(); i++) {
+        bool value;
+        Get(value);
+        values[i] = value;
+    }
+}
+
+void CheckpointReader::ExpectSize(size_t size) {
+    uint64_t actual;
+    Get(actual);
+    if (actual != size) {
+        ok_ = false;
+    }
+}
+
+void CheckpointReader::GetBytes(char* data, size_t size) {
+    if (ok_ && !in_.read(data, size)) {
+        ok_ = false;
+    }
+    if (!ok_) {
+        std::fill(data, data + size, 0);
+    }
+}
+
+uint64_t CheckpointReader::GetSize() {
+    uint64_t size;
+    Get(size);
+    if (size > kMaxVectorSize) {
+        ok_ = false;
+        size = 0;
+    }
+    return size;
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,98 @@
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "memory_request.h"
+
+namespace dramsim3 {
+
+// Memory system snapshot format:
+//   header: 8 byte magic "DS3CKPT\0", then as varints the version and the
+//   shape of the system (protocol, channels, ranks, bankgroups,
+//   banks_per_group)
+//   body: the state of the system and its controllers, each object writes
+//   its members in a fixed order, see the SaveState/RestoreState methods
+// Every integer is a LEB128 varint (zigzag encoded if signed) so the mostly
+// small counters and indices take a byte or two. Anything that follows from
+// the config (timing constraints, stat names, queue sizes) is not saved, a
+// snapshot restores into any system built from a config of the same shape
+// whose queues can hold what was queued.
+const char kCheckpointMagic[] = "DS3CKPT";
+const size_t kCheckpointMagicSize = 8;
+const uint32_t kCheckpointVersion = 1;
+
+class CheckpointWriter {
+   public:
+    explicit CheckpointWriter(std::ostream& out) : out_(out) {}
+
+    void Put(uint64_t value);
+    void Put(int64_t value);
+    void Put(uint32_t value) { Put(static_cast<uint64_t>(value)); }
+    void Put(int value) { Put(static_cast<int64_t>(value)); }
+    void Put(bool value) { Put(static_cast<uint64_t>(value)); }
+    void Put(const Command& cmd);
+    void Put(const Transaction& trans);
+    void Put(const MemoryRequest& req);
+    void Put(const std::vector<bool>& values);
+    template <typename T>
+    void Put(const std::vector<T>& values) {
+        Put(static_cast<uint64_t>(values.size()));
+        for (const auto& value : values) {
+            Put(value);
+        }
+    }
+    void PutBytes(const char* data, size_t size) { out_.write(data, size); }
+
+    bool Ok() const { return out_.good(); }
+
+   private:
+    std::ostream& out_;
+};
+
+// Reads back what CheckpointWriter wrote. A truncated or malformed snapshot
+// makes every later Get return zeros and Ok() false, so restore code can read
+// straight through and check once at the end.
+class CheckpointReader {
+   public:
+    explicit CheckpointReader(std::istream& in) : in_(in), ok_(true) {}
+
+    void Get(uint64_t& value);
+    void Get(int64_t& value);
+    void Get(uint32_t& value);
+    void Get(int& value);
+    void Get(bool& value);
+    void Get(Command& cmd);
+    void Get(Transaction& trans);
+    void Get(MemoryRequest& req);
+    void Get(std::vector<bool>& values);
+    template <typename T>
+    void Get(std::vector<T>& values) {
+        uint64_t size = GetSize();
+        values.resize(size);
+        for (auto& value : values) {
+            Get(value);
+        }
+    }
+    // length of the vector that follows
+    uint64_t GetSize();
+    // length of a vector that is fixed by the config, the snapshot is
+    // rejected if it does not have that length
+    void ExpectSize(size_t size);
+    void GetBytes(char* data, size_t size);
+
+    // fail the whole restore, e.g. on a value that cannot be right
+    void Fail() { ok_ = false; }
+    bool Ok() const { return ok_; }
+
+   private:
+    std::istream& in_;
+    bool ok_;
+};
+
+}  // namespace dramsim3
+#endif
@@ -0,0 +1,80 @@
+#include "column_writer.h"
+
+#include <iostream>
+
+#include "common.h"
+
+namespace dramsim3 {
+
+namespace {
+// rows per block
+const size_t kColumnBlockRows = 1024;
+
+void PutLE(std::string& out, uint64_t value, int num_bytes) {
+    for (int i = 0; i < num_bytes; i++) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+}  // namespace
+
+ColumnWriter::ColumnWriter(const std::string& file_name)
+    : out_(file_name), header_written_(false), num_rows_(0) {}
+
+ColumnWriter::~ColumnWriter() { WriteBlock(); }
+
+void ColumnWriter::SetSchema(const std::vector<Column>& columns) {
+    columns_ = columns;
+    block_.assign(columns_.size() * kColumnBlockRows, 0);
+}
+
+void ColumnWriter::AddRow(const std::vector<uint64_t>& values) {
+    if (values.size() != columns_.size()) {
+        std::cerr << "Row of " << values.size() << " values for "
+                  << columns_.size() << " columns" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    for (size_t i = 0; i < values.size(); i++) {
+        block_[i * kColumnBlockRows + num_rows_] = values[i];
+    }
+    num_rows_++;
+    if (num_rows_ == kColumnBlockRows) {
+        WriteBlock();
+    }
+}
+
+void ColumnWriter::Flush() {
+    WriteBlock();
+    out_.Flush();
+}
+
+void ColumnWriter::WriteBlock() {
+    if (num_rows_ == 0) {
+        return;
+    }
+    std::string bytes;
+    if (!header_written_) {
+        bytes.append(kColumnMagic, kColumnMagicSize);
+        PutLE(bytes, kColumnVersion, 4);
+        PutLE(bytes, columns_.size(), 4);
+        for (const auto& column : columns_) {
+            PutLE(bytes, static_cast<uint8_t>(column.type), 1);
+            PutLE(bytes, 0, 1);
+            PutLE(bytes, column.name.size(), 2);
+            bytes += column.name;
+        }
+        header_written_ = true;
+    }
+    PutLE(bytes, num_rows_, 4);
+    PutLE(bytes, 0, 4);
+    bytes.reserve(bytes.size() + columns_.size() * num_rows_ * 8);
+    for (size_t i = 0; i < columns_.size(); i++) {
+        const uint64_t* values = &block_[i * kColumnBlockRows];
+        for (size_t row = 0; row < num_rows_; row++) {
+            PutLE(bytes, values[row], 8);
+        }
+    }
+    out_.Write(bytes.data(), bytes.size());
+    num_rows_ = 0;
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,59 @@
+#ifndef __COLUMN_WRITER_H
+#define __COLUMN_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "stats_writer.h"
+
+namespace dramsim3 {
+
+// Columnar epoch stats format, little endian:
+//   header: 8 byte magic "DS3EPOCH", uint32 version, uint32 number of columns
+//   schema: per column a uint8 type (ColumnType), a uint8 reserved (0), a
+//   uint16 name length and the name
+//   blocks: uint32 number of rows, uint32 reserved (0), then each column's
+//   values of those rows, 8 bytes apiece
+// Every row is one channel in one epoch. A block holds a column's values
+// back to back so a reader can load a whole column of a block in one go,
+// scripts/epoch_columns.py reads the format.
+const char kColumnMagic[] = "DS3EPOCH";
+const size_t kColumnMagicSize = 8;
+const uint32_t kColumnVersion = 1;
+
+enum class ColumnType : uint8_t { UINT64 = 0, INT64 = 1, DOUBLE = 2 };
+
+struct Column {
+    std::string name;
+    ColumnType type;
+};
+
+// Collects rows into blocks and hands full blocks to a StatsWriter, the
+// schema is written with the first block
+class ColumnWriter {
+   public:
+    explicit ColumnWriter(const std::string& file_name);
+    ~ColumnWriter();
+
+    // set once before the first row
+    bool HasSchema() const { return !columns_.empty(); }
+    void SetSchema(const std::vector<Column>& columns);
+    // one value per column, doubles and signed values by their bits
+    void AddRow(const std::vector<uint64_t>& values);
+    // write out the rows so far as a (short) block and wait for the file
+    void Flush();
+
+   private:
+    StatsWriter out_;
+    std::vector<Column> columns_;
+    bool header_written_;
+    // column major, columns_.size() times kColumnBlockRows values
+    std::vector<uint64_t> block_;
+    size_t num_rows_;
+
+    void WriteBlock();
+};
+
+}  // namespace dramsim3
+#endif
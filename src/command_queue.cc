@@ -1,5 +1,10 @@
 #include "command_queue.h"
 
+#include <algorithm>
+#include <limits>
+
+#include "profiler.h"
+
 namespace dramsim3 {
 
 CommandQueue::CommandQueue(int channel_id, const Config& config,
@@ -9,6 +14,7 @@ CommandQueue::CommandQueue(int channel_id, const Config& config,
       config_(config),
       channel_state_(channel_state),
       simple_stats_(simple_stats),
+      num_ondemand_pres_(simple_stats.GetStat("num_ondemand_pres")),
       is_in_ref_(false),
       queue_size_(static_cast<size_t>(config_.cmd_queue_size)),
       queue_idx_(0),
@@ -25,6 +31,7 @@ CommandQueue::CommandQueue(int channel_id, const Config& config,
         AbruptExit(__FILE__, __LINE__);
     }
 
+    queue_ready_cycles_.resize(num_queues_, 0);
     queues_.reserve(num_queues_);
     for (int i = 0; i < num_queues_; i++) {
         auto cmd_queue = std::vector<Command>();
@@ -34,6 +41,7 @@ CommandQueue::CommandQueue(int channel_id, const Config& config,
 }
 
 Command CommandQueue::GetCommandToIssue() {
+    PROFILE_SCOPE(GET_COMMAND);
     for (int i = 0; i < num_queues_; i++) {
         auto& queue = GetNextQueue();
         // if we're refresing, skip the command queues that are involved
@@ -42,6 +50,9 @@ Command CommandQueue::GetCommandToIssue() {
                 continue;
             }
         }
+        if (clk_ < queue_ready_cycles_[queue_idx_]) {
+            continue;
+        }
         auto cmd = GetFirstReadyInQueue(queue);
         if (cmd.IsValid()) {
             if (cmd.IsReadWrite()) {
@@ -49,10 +60,21 @@ Command CommandQueue::GetCommandToIssue() {
             }
             return cmd;
         }
+        // commands that are ready by timing but still not issuable are held
+        // back by arbitration, which only changes when the queue or its banks
+        // change, so the queue only needs another look when a later one is
+        queue_ready_cycles_[queue_idx_] = NextReadyCycle(queue);
     }
     return Command();
 }
 
+void CommandQueue::FunctionalSkip(uint64_t cycles) {
+    clk_ += cycles;
+    ref_q_indices_.clear();
+    is_in_ref_ = false;
+    std::fill(queue_ready_cycles_.begin(), queue_ready_cycles_.end(), 0);
+}
+
 Command CommandQueue::FinishRefresh() {
     // we can do something fancy here like clearing the R/Ws
     // that already had ACT on the way but by doing that we
@@ -103,7 +125,7 @@ bool CommandQueue::ArbitratePrecharge(const CMDIterator& cmd_it,
         channel_state_.RowHitCount(cmd.Rank(), cmd.Bankgroup(), cmd.Bank()) >=
         4;
     if (!pending_row_hits_exist || rowhit_limit_reached) {
-        simple_stats_.Increment("num_ondemand_pres");
+        simple_stats_.Increment(num_ondemand_pres_);
         return true;
     }
     return false;
@@ -129,12 +151,27 @@ bool CommandQueue::AddCommand(Command cmd) {
     if (queue.size() < queue_size_) {
         queue.push_back(cmd);
         rank_q_empty[cmd.Rank()] = false;
+        queue_ready_cycles_[GetQueueIndex(cmd.Rank(), cmd.Bankgroup(),
+                                          cmd.Bank())] = 0;
         return true;
     } else {
         return false;
     }
 }
 
+void CommandQueue::InvalidateReadyCycles(const Command& cmd) {
+    if (!cmd.IsRankCMD()) {
+        queue_ready_cycles_[GetQueueIndex(cmd.Rank(), cmd.Bankgroup(),
+                                          cmd.Bank())] = 0;
+    } else if (queue_structure_ == QueueStructure::PER_BANK) {
+        for (int i = 0; i < config_.banks; i++) {
+            queue_ready_cycles_[cmd.Rank() * config_.banks + i] = 0;
+        }
+    } else {
+        queue_ready_cycles_[cmd.Rank()] = 0;
+    }
+}
+
 CMDQueue& CommandQueue::GetNextQueue() {
     queue_idx_++;
     if (queue_idx_ == num_queues_) {
@@ -207,6 +244,34 @@ void CommandQueue::EraseRWCommand(const Command& cmd) {
     exit(1);
 }
 
+uint64_t CommandQueue::NextReadyCycle() const {
+    // commands that are past their timing but were not issued last cycle are
+    // held back by arbitration, which only changes when some other command is
+    // issued, so only the ones still waiting on timing are of interest
+    uint64_t next_cycle = std::numeric_limits<uint64_t>::max();
+    for (const auto& queue : queues_) {
+        for (const auto& cmd : queue) {
+            uint64_t ready_cycle = channel_state_.GetReadyCycle(cmd);
+            if (ready_cycle >= clk_ && ready_cycle < next_cycle) {
+                next_cycle = ready_cycle;
+            }
+        }
+    }
+    return next_cycle;
+}
+
+uint64_t CommandQueue::NextReadyCycle(const CMDQueue& queue) const {
+    // same as above but for a queue that was just looked at this cycle
+    uint64_t next_cycle = std::numeric_limits<uint64_t>::max();
+    for (const auto& cmd : queue) {
+        uint64_t ready_cycle = channel_state_.GetReadyCycle(cmd);
+        if (ready_cycle > clk_ && ready_cycle < next_cycle) {
+            next_cycle = ready_cycle;
+        }
+    }
+    return next_cycle;
+}
+
 int CommandQueue::QueueUsage() const {
     int usage = 0;
     for (auto i = queues_.begin(); i != queues_.end(); i++) {
@@ -229,4 +294,43 @@ bool CommandQueue::HasRWDependency(const CMDIterator& cmd_it,
     return false;
 }
 
+void CommandQueue::SaveState(CheckpointWriter& ckpt) const {
+    ckpt.Put(rank_q_empty);
+    ckpt.Put(queues_);
+    // only ever looked up, order does not matter
+    std::vector<int> ref_q_indices(ref_q_indices_.begin(),
+                                   ref_q_indices_.end());
+    std::sort(ref_q_indices.begin(), ref_q_indices.end());
+    ckpt.Put(ref_q_indices);
+    ckpt.Put(is_in_ref_);
+    ckpt.Put(queue_idx_);
+    ckpt.Put(clk_);
+}
+
+void CommandQueue::RestoreState(CheckpointReader& ckpt) {
+    ckpt.Get(rank_q_empty);
+    ckpt.Get(queues_);
+    std::vector<int> ref_q_indices;
+    ckpt.Get(ref_q_indices);
+    ref_q_indices_.clear();
+    ref_q_indices_.insert(ref_q_indices.begin(), ref_q_indices.end());
+    ckpt.Get(is_in_ref_);
+    ckpt.Get(queue_idx_);
+    ckpt.Get(clk_);
+    // a config with shorter queues cannot take what was queued
+    bool queues_fit = std::all_of(
+        queues_.begin(), queues_.end(),
+        [this](const CMDQueue& queue) { return queue.size() <= queue_size_; });
+    if (rank_q_empty.size() != static_cast<size_t>(config_.ranks) ||
+        queues_.size() != static_cast<size_t>(num_queues_) || queue_idx_ < 0 ||
+        queue_idx_ >= num_queues_ || !queues_fit) {
+        ckpt.Fail();
+        rank_q_empty.assign(config_.ranks, true);
+        queues_.assign(num_queues_, CMDQueue());
+        queue_idx_ = 0;
+    }
+    // ready cycles are lower bounds, 0 is always safe
+    std::fill(queue_ready_cycles_.begin(), queue_ready_cycles_.end(), 0);
+}
+
 }  // namespace dramsim3
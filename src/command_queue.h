@@ -4,6 +4,7 @@
 #include <unordered_set>
 #include <vector>
 #include "channel_state.h"
+#include "checkpoint.h"
 #include "common.h"
 #include "configuration.h"
 #include "simple_stats.h"
@@ -21,10 +22,19 @@ class CommandQueue {
     Command GetCommandToIssue();
     Command FinishRefresh();
     void ClockTick() { clk_ += 1; };
+    void SkipCycles(uint64_t cycles) { clk_ += cycles; }
+    // functional fast-forward, refreshes were done and banks changed state
+    // behind the queue's back
+    void FunctionalSkip(uint64_t cycles);
+    uint64_t NextReadyCycle() const;
     bool WillAcceptCommand(int rank, int bankgroup, int bank) const;
     bool AddCommand(Command cmd);
+    // cmd was issued so the states of the banks it goes to may have changed
+    void InvalidateReadyCycles(const Command& cmd);
     bool QueueEmpty() const;
     int QueueUsage() const;
+    void SaveState(CheckpointWriter& ckpt) const;
+    void RestoreState(CheckpointReader& ckpt);
     std::vector<bool> rank_q_empty;
 
    private:
@@ -33,6 +43,7 @@ class CommandQueue {
     bool HasRWDependency(const CMDIterator& cmd_it,
                          const CMDQueue& queue) const;
     Command GetFirstReadyInQueue(CMDQueue& queue) const;
+    uint64_t NextReadyCycle(const CMDQueue& queue) const;
     int GetQueueIndex(int rank, int bankgroup, int bank) const;
     CMDQueue& GetQueue(int rank, int bankgroup, int bank);
     CMDQueue& GetNextQueue();
@@ -44,9 +55,15 @@ class CommandQueue {
     const Config& config_;
     const ChannelState& channel_state_;
     SimpleStats& simple_stats_;
+    StatHandle num_ondemand_pres_;
 
     std::vector<CMDQueue> queues_;
 
+    // per queue, no command in it can be issued before this cycle. Bank
+    // timings only ever move forward, so this stays a lower bound until a
+    // command is added to the queue or the state of one of its banks changes
+    std::vector<uint64_t> queue_ready_cycles_;
+
     // Refresh related data structures
     std::unordered_set<int> ref_q_indices_;
     bool is_in_ref_;
@@ -0,0 +1,64 @@
+#ifndef __COMPLETION_SINK_H
+#define __COMPLETION_SINK_H
+
+#include <cstddef>
+#include <thread>
+#include "memory_request.h"
+#include "spsc_ring.h"
+
+namespace dramsim3 {
+
+// Receives the transactions a memory system finished, all of a cycle in one
+// call, so there is one indirect call per cycle rather than per transaction.
+// Called from the thread that calls ClockTick.
+class CompletionSink {
+   public:
+    virtual ~CompletionSink() {}
+    virtual void Complete(const MemoryRequest *done, size_t count) = 0;
+};
+
+// CRTP helper for sinks that handle one completion at a time:
+//   class MyCPU : public CompletionSinkAdapter<MyCPU> {
+//       void OnCompletion(const MemoryRequest &done) { ... }
+//   };
+// OnCompletion is called directly in the batch loop and can be inlined.
+template <typename Handler>
+class CompletionSinkAdapter : public CompletionSink {
+   public:
+    void Complete(const MemoryRequest *done, size_t count) override {
+        Handler &handler = static_cast<Handler &>(*this);
+        for (size_t i = 0; i < count; i++) {
+            handler.OnCompletion(done[i]);
+        }
+    }
+};
+
+// Hands completions over to a host thread through a lock-free ring that the
+// host drains in bulk. The simulation thread waits for space when the ring
+// is full, so a host that drains from the simulation thread itself must
+// size the ring for everything that can complete between two drains.
+class CompletionRing : public CompletionSink {
+   public:
+    CompletionRing(size_t capacity) : ring_(capacity) {}
+
+    void Complete(const MemoryRequest *done, size_t count) override {
+        size_t num_pushed = ring_.TryPushBulk(done, count);
+        while (num_pushed < count) {
+            std::this_thread::yield();
+            num_pushed +=
+                ring_.TryPushBulk(done + num_pushed, count - num_pushed);
+        }
+    }
+
+    // move up to capacity completions into completions oldest first,
+    // returns how many were moved
+    size_t Drain(MemoryRequest *completions, size_t capacity) {
+        return ring_.TryPopBulk(completions, capacity);
+    }
+
+   private:
+    SpscRing<MemoryRequest> ring_;
+};
+
+}  // namespace dramsim3
+#endif
@@ -160,6 +160,22 @@ void Config::InitOtherParams() {
     // 1: default value, adds epoch CSV output on level 0
     // 2: adds histogram outputs in a different CSV format
     output_level = reader.GetInteger("other", "output_level", 1);
+    // epoch stats as JSON lines, binary columns (see column_writer.h) or both
+    std::string epoch_format = reader.Get("other", "epoch_format", "json");
+    if (epoch_format != "json" && epoch_format != "columnar" &&
+        epoch_format != "both") {
+        std::cerr << "Unknown epoch_format " << epoch_format
+                  << ", expecting json, columnar or both" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    epoch_json = epoch_format != "columnar";
+    epoch_columnar = epoch_format != "json";
+    // skip over cycles in which the controllers have nothing to do instead of
+    // ticking through them, stats are the same as cycle by cycle simulation
+    event_driven = reader.GetBoolean("other", "event_driven", false);
+    // tick channels/vaults on this many threads, results are the same
+    // regardless of the number of threads
+    num_threads = GetInteger("other", "num_threads", 1);
     // Other Parameters
     // give a prefix instead of specify the output name one by one...
     // this would allow outputing to a directory and you can always override
@@ -175,7 +191,8 @@ void Config::InitOtherParams() {
     output_prefix =
         output_dir + reader.Get("other", "output_prefix", "dramsim3");
     json_stats_name = output_prefix + ".json";
-    json_epoch_name = output_prefix + "epoch.json";
+    json_epoch_name = output_prefix + "epoch.jsonl";
+    columnar_epoch_name = output_prefix + "epoch.bin";
     txt_stats_name = output_prefix + ".txt";
     return;
 }
@@ -137,10 +137,15 @@ class Config {
 
     int epoch_period;
     int output_level;
+    bool epoch_json;
+    bool epoch_columnar;
+    bool event_driven;
+    int num_threads;
     std::string output_dir;
     std::string output_prefix;
     std::string json_stats_name;
     std::string json_epoch_name;
+    std::string columnar_epoch_name;
     std::string txt_stats_name;
 
     // Computed parameters
@@ -1,7 +1,9 @@
 #include "controller.h"
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include "profiler.h"
 
 namespace dramsim3 {
 
@@ -22,11 +24,18 @@ Controller::Controller(int channel, const Config &config, const Timing &timing)
       thermal_calc_(thermal_calc),
 #endif  // THERMAL
       is_unified_queue_(config.unified_queue),
+      trans_queue_size_(static_cast<size_t>(config.trans_queue_size)),
+      pending_rd_q_(config.trans_queue_size),
+      pending_wr_q_(config.trans_queue_size),
+      return_seq_(0),
       row_buf_policy_(config.row_buf_policy == "CLOSE_PAGE"
                           ? RowBufPolicy::CLOSE_PAGE
                           : RowBufPolicy::OPEN_PAGE),
       last_trans_clk_(0),
+      quiescent_(false),
+      schedule_blocked_(false),
       write_draining_(0) {
+    InitStatHandles();
     if (is_unified_queue_) {
         unified_queue_.reserve(config_.trans_queue_size);
     } else {
@@ -43,26 +52,118 @@ Controller::Controller(int channel, const Config &config, const Timing &timing)
 }
 
 std::pair<uint64_t, int> Controller::ReturnDoneTrans(uint64_t clk) {
-    auto it = return_queue_.begin();
-    while (it != return_queue_.end()) {
-        if (clk >= it->complete_cycle) {
-            if (it->is_write) {
-                simple_stats_.Increment("num_writes_done");
-            } else {
-                simple_stats_.Increment("num_reads_done");
-                simple_stats_.AddValue("read_latency", clk_ - it->added_cycle);
+    if (return_queue_.empty() ||
+        return_queue_.front().trans.complete_cycle > clk) {
+        return std::make_pair(-1, -1);
+    }
+    Transaction trans = PopDoneTrans();
+    return std::make_pair(trans.addr, static_cast<int>(trans.is_write));
+}
+
+size_t Controller::ReturnDoneTrans(uint64_t clk,
+                                   std::vector<Transaction> &done) {
+    size_t num_done = 0;
+    while (!return_queue_.empty() &&
+           return_queue_.front().trans.complete_cycle <= clk) {
+        done.push_back(PopDoneTrans());
+        num_done++;
+    }
+    return num_done;
+}
+
+void Controller::PushDoneTrans(const Transaction &trans) {
+    return_queue_.push_back(DoneTrans{return_seq_++, trans});
+    std::push_heap(return_queue_.begin(), return_queue_.end(),
+                   DoneTransLater());
+}
+
+Transaction Controller::PopDoneTrans() {
+    std::pop_heap(return_queue_.begin(), return_queue_.end(),
+                  DoneTransLater());
+    Transaction trans = return_queue_.back().trans;
+    if (trans.is_write) {
+        simple_stats_.Increment(stats_.num_writes_done);
+    } else {
+        simple_stats_.Increment(stats_.num_reads_done);
+        simple_stats_.AddValue(stats_.read_latency, clk_ - trans.added_cycle);
+    }
+    return_queue_.pop_back();
+    return trans;
+}
+
+uint64_t Controller::NextEventCycle() const {
+    if (!quiescent_) {
+        return clk_;
+    }
+    uint64_t next_cycle = refresh_.NextRefreshCycle();
+    next_cycle = std::min(next_cycle, cmd_queue_.NextReadyCycle());
+    if (!return_queue_.empty()) {
+        next_cycle =
+            std::min(next_cycle, return_queue_.front().trans.complete_cycle);
+    }
+    if (config_.enable_self_refresh) {
+        for (int i = 0; i < config_.ranks; i++) {
+            if (channel_state_.IsRankSelfRefreshing(i)) {
+                if (!cmd_queue_.rank_q_empty[i]) {
+                    return clk_;
+                }
+            } else if (cmd_queue_.rank_q_empty[i] &&
+                       channel_state_.IsAllBankIdleInRank(i)) {
+                // idle cycles are counted before the threshold is checked
+                int64_t ticks = static_cast<int64_t>(config_.sref_threshold) -
+                                channel_state_.rank_idle_cycles[i] - 1;
+                uint64_t sref_cycle = clk_ + std::max<int64_t>(ticks, 0);
+                next_cycle = std::min(next_cycle, sref_cycle);
             }
-            auto pair = std::make_pair(it->addr, it->is_write);
-            it = return_queue_.erase(it);
-            return pair;
+        }
+    }
+    return next_cycle;
+}
+
+void Controller::FastForward(uint64_t clk) {
+    if (clk <= clk_) {
+        return;
+    }
+    uint64_t cycles = clk - clk_;
+    // nothing is issued in between so the rank states stay as they are
+    for (int i = 0; i < config_.ranks; i++) {
+        if (channel_state_.IsRankSelfRefreshing(i)) {
+            simple_stats_.IncrementVecBy(stats_.sref_cycles, i, cycles);
+        } else if (channel_state_.IsAllBankIdleInRank(i)) {
+            simple_stats_.IncrementVecBy(stats_.all_bank_idle_cycles, i, cycles);
+            channel_state_.rank_idle_cycles[i] += static_cast<int>(cycles);
         } else {
-            ++it;
+            simple_stats_.IncrementVecBy(stats_.rank_active_cycles, i, cycles);
+            channel_state_.rank_idle_cycles[i] = 0;
         }
     }
-    return std::make_pair(-1, -1);
+    refresh_.SkipCycles(cycles);
+    cmd_queue_.SkipCycles(cycles);
+    simple_stats_.IncrementBy(stats_.num_cycles, cycles);
+    clk_ = clk;
+    return;
+}
+
+void Controller::FunctionalSkip(uint64_t clk) {
+    if (clk <= clk_) {
+        return;
+    }
+    uint64_t cycles = clk - clk_;
+    refresh_.FunctionalSkip(cycles);
+    cmd_queue_.FunctionalSkip(cycles);
+    clk_ = clk;
+    quiescent_ = false;
+    schedule_blocked_ = false;
+}
+
+void Controller::FunctionalAccess(const Transaction &trans) {
+    channel_state_.FunctionalUpdate(TransToCommand(trans));
+    quiescent_ = false;
+    schedule_blocked_ = false;
 }
 
 void Controller::ClockTick() {
+    quiescent_ = true;
     // update refresh counter
     refresh_.ClockTick();
 
@@ -84,9 +185,11 @@ void Controller::ClockTick() {
         if (config_.enable_hbm_dual_cmd) {
             auto second_cmd = cmd_queue_.GetCommandToIssue();
             if (second_cmd.IsValid()) {
+                // taken out of the queue even if it is not issued below
+                schedule_blocked_ = false;
                 if (second_cmd.IsReadWrite() != cmd.IsReadWrite()) {
                     IssueCommand(second_cmd);
-                    simple_stats_.Increment("hbm_dual_cmds");
+                    simple_stats_.Increment(stats_.hbm_dual_cmds);
                 }
             }
         }
@@ -95,14 +198,14 @@ void Controller::ClockTick() {
     // power updates pt 1
     for (int i = 0; i < config_.ranks; i++) {
         if (channel_state_.IsRankSelfRefreshing(i)) {
-            simple_stats_.IncrementVec("sref_cycles", i);
+            simple_stats_.IncrementVec(stats_.sref_cycles, i);
         } else {
             bool all_idle = channel_state_.IsAllBankIdleInRank(i);
             if (all_idle) {
-                simple_stats_.IncrementVec("all_bank_idle_cycles", i);
+                simple_stats_.IncrementVec(stats_.all_bank_idle_cycles, i);
                 channel_state_.rank_idle_cycles[i] += 1;
             } else {
-                simple_stats_.IncrementVec("rank_active_cycles", i);
+                simple_stats_.IncrementVec(stats_.rank_active_cycles, i);
                 // reset
                 channel_state_.rank_idle_cycles[i] = 0;
             }
@@ -142,52 +245,57 @@ void Controller::ClockTick() {
     }
 
     ScheduleTransaction();
+    if (channel_state_.IsRefreshWaiting()) {
+        quiescent_ = false;
+    }
     clk_++;
     cmd_queue_.ClockTick();
-    simple_stats_.Increment("num_cycles");
+    simple_stats_.Increment(stats_.num_cycles);
     return;
 }
 
 bool Controller::WillAcceptTransaction(uint64_t hex_addr, bool is_write) const {
     if (is_unified_queue_) {
-        return unified_queue_.size() < unified_queue_.capacity();
+        return unified_queue_.size() < trans_queue_size_;
     } else if (!is_write) {
-        return read_queue_.size() < read_queue_.capacity();
+        return read_queue_.size() < trans_queue_size_;
     } else {
-        return write_buffer_.size() < write_buffer_.capacity();
+        return write_buffer_.size() < trans_queue_size_;
     }
 }
 
 bool Controller::AddTransaction(Transaction trans) {
     trans.added_cycle = clk_;
-    simple_stats_.AddValue("interarrival_latency", clk_ - last_trans_clk_);
+    simple_stats_.AddValue(stats_.interarrival_latency, clk_ - last_trans_clk_);
     last_trans_clk_ = clk_;
+    quiescent_ = false;
+    schedule_blocked_ = false;
 
     if (trans.is_write) {
-        if (pending_wr_q_.count(trans.addr) == 0) {  // can not merge writes
-            pending_wr_q_.insert(std::make_pair(trans.addr, trans));
+        if (!pending_wr_q_.Contains(trans.addr)) {  // can not merge writes
+            pending_wr_q_.Insert(trans);
             if (is_unified_queue_) {
-                unified_queue_.push_back(trans);
+                unified_queue_.push_back(TransToCommand(trans));
             } else {
-                write_buffer_.push_back(trans);
+                write_buffer_.push_back(TransToCommand(trans));
             }
         }
         trans.complete_cycle = clk_ + 1;
-        return_queue_.push_back(trans);
+        PushDoneTrans(trans);
         return true;
     } else {  // read
         // if in write buffer, use the write buffer value
-        if (pending_wr_q_.count(trans.addr) > 0) {
+        if (pending_wr_q_.Contains(trans.addr)) {
             trans.complete_cycle = clk_ + 1;
-            return_queue_.push_back(trans);
+            PushDoneTrans(trans);
             return true;
         }
-        pending_rd_q_.insert(std::make_pair(trans.addr, trans));
-        if (pending_rd_q_.count(trans.addr) == 1) {
+        // only the first read to an address needs to be scheduled
+        if (pending_rd_q_.Insert(trans) == 1) {
             if (is_unified_queue_) {
-                unified_queue_.push_back(trans);
+                unified_queue_.push_back(TransToCommand(trans));
             } else {
-                read_queue_.push_back(trans);
+                read_queue_.push_back(TransToCommand(trans));
             }
         }
         return true;
@@ -195,25 +303,32 @@ bool Controller::AddTransaction(Transaction trans) {
 }
 
 void Controller::ScheduleTransaction() {
+    PROFILE_SCOPE(SCHEDULE_TRANSACTION);
+    if (schedule_blocked_) {
+        return;
+    }
+    int prev_write_draining = write_draining_;
+    schedule_blocked_ = true;
+
     // determine whether to schedule read or write
     if (write_draining_ == 0 && !is_unified_queue_) {
         // we basically have a upper and lower threshold for write buffer
-        if ((write_buffer_.size() >= write_buffer_.capacity()) ||
+        if ((write_buffer_.size() >= trans_queue_size_) ||
             (write_buffer_.size() > 8 && cmd_queue_.QueueEmpty())) {
             write_draining_ = write_buffer_.size();
         }
     }
 
-    std::vector<Transaction> &queue =
+    std::vector<Command> &queue =
         is_unified_queue_ ? unified_queue_
                           : write_draining_ > 0 ? write_buffer_ : read_queue_;
     for (auto it = queue.begin(); it != queue.end(); it++) {
-        auto cmd = TransToCommand(*it);
+        const auto &cmd = *it;
         if (cmd_queue_.WillAcceptCommand(cmd.Rank(), cmd.Bankgroup(),
                                          cmd.Bank())) {
             if (!is_unified_queue_ && cmd.IsWrite()) {
                 // Enforce R->W dependency
-                if (pending_rd_q_.count(it->addr) > 0) {
+                if (pending_rd_q_.Contains(cmd.hex_addr)) {
                     write_draining_ = 0;
                     break;
                 }
@@ -221,12 +336,21 @@ void Controller::ScheduleTransaction() {
             }
             cmd_queue_.AddCommand(cmd);
             queue.erase(it);
+            quiescent_ = false;
+            schedule_blocked_ = false;
             break;
         }
     }
+    // e.g. a stopped write drain, the next call scans another queue
+    if (write_draining_ != prev_write_draining) {
+        quiescent_ = false;
+        schedule_blocked_ = false;
+    }
 }
 
 void Controller::IssueCommand(const Command &cmd) {
+    quiescent_ = false;
+    schedule_blocked_ = false;
 #ifdef CMD_TRACE
     cmd_trace_ << std::left << std::setw(18) << clk_ << " " << cmd << std::endl;
 #endif  // CMD_TRACE
@@ -236,33 +360,31 @@ void Controller::IssueCommand(const Command &cmd) {
 #endif  // THERMAL
     // if read/write, update pending queue and return queue
     if (cmd.IsRead()) {
-        auto num_reads = pending_rd_q_.count(cmd.hex_addr);
+        // if there are multiple reads pending return them all
+        auto num_reads =
+            pending_rd_q_.Drain(cmd.hex_addr, [this](Transaction &trans) {
+                trans.complete_cycle = clk_ + config_.read_delay;
+                PushDoneTrans(trans);
+            });
         if (num_reads == 0) {
             std::cerr << cmd.hex_addr << " not in read queue! " << std::endl;
             exit(1);
         }
-        // if there are multiple reads pending return them all
-        while (num_reads > 0) {
-            auto it = pending_rd_q_.find(cmd.hex_addr);
-            it->second.complete_cycle = clk_ + config_.read_delay;
-            return_queue_.push_back(it->second);
-            pending_rd_q_.erase(it);
-            num_reads -= 1;
-        }
     } else if (cmd.IsWrite()) {
         // there should be only 1 write to the same location at a time
-        auto it = pending_wr_q_.find(cmd.hex_addr);
-        if (it == pending_wr_q_.end()) {
+        auto trans = pending_wr_q_.Front(cmd.hex_addr);
+        if (trans == nullptr) {
             std::cerr << cmd.hex_addr << " not in write queue!" << std::endl;
             exit(1);
         }
-        auto wr_lat = clk_ - it->second.added_cycle + config_.write_delay;
-        simple_stats_.AddValue("write_latency", wr_lat);
-        pending_wr_q_.erase(it);
+        auto wr_lat = clk_ - trans->added_cycle + config_.write_delay;
+        simple_stats_.AddValue(stats_.write_latency, wr_lat);
+        pending_wr_q_.PopFront(cmd.hex_addr);
     }
     // must update stats before states (for row hits)
     UpdateCommandStats(cmd);
     channel_state_.UpdateTimingAndStates(cmd, clk_);
+    cmd_queue_.InvalidateReadyCycles(cmd);
 }
 
 Command Controller::TransToCommand(const Transaction &trans) {
@@ -279,9 +401,10 @@ Command Controller::TransToCommand(const Transaction &trans) {
 
 int Controller::QueueUsage() const { return cmd_queue_.QueueUsage(); }
 
-void Controller::PrintEpochStats() {
-    simple_stats_.Increment("epoch_num");
-    simple_stats_.PrintEpochStats();
+void Controller::PrintEpochStats(StatsWriter& json_out,
+                                 ColumnWriter& column_out) {
+    simple_stats_.Increment(stats_.epoch_num);
+    simple_stats_.PrintEpochStats(json_out, column_out);
 #ifdef THERMAL
     for (int r = 0; r < config_.ranks; r++) {
         double bg_energy = simple_stats_.RankBackgroundEnergy(r);
@@ -303,45 +426,134 @@ void Controller::PrintFinalStats() {
     return;
 }
 
+void Controller::InitStatHandles() {
+    stats_.num_cycles = simple_stats_.GetStat("num_cycles");
+    stats_.epoch_num = simple_stats_.GetStat("epoch_num");
+    stats_.num_reads_done = simple_stats_.GetStat("num_reads_done");
+    stats_.num_writes_done = simple_stats_.GetStat("num_writes_done");
+    stats_.hbm_dual_cmds = simple_stats_.GetStat("hbm_dual_cmds");
+    stats_.num_read_cmds = simple_stats_.GetStat("num_read_cmds");
+    stats_.num_write_cmds = simple_stats_.GetStat("num_write_cmds");
+    stats_.num_act_cmds = simple_stats_.GetStat("num_act_cmds");
+    stats_.num_pre_cmds = simple_stats_.GetStat("num_pre_cmds");
+    stats_.num_ref_cmds = simple_stats_.GetStat("num_ref_cmds");
+    stats_.num_refb_cmds = simple_stats_.GetStat("num_refb_cmds");
+    stats_.num_srefe_cmds = simple_stats_.GetStat("num_srefe_cmds");
+    stats_.num_srefx_cmds = simple_stats_.GetStat("num_srefx_cmds");
+    stats_.num_read_row_hits = simple_stats_.GetStat("num_read_row_hits");
+    stats_.num_write_row_hits = simple_stats_.GetStat("num_write_row_hits");
+    stats_.sref_cycles = simple_stats_.GetVecStat("sref_cycles");
+    stats_.all_bank_idle_cycles =
+        simple_stats_.GetVecStat("all_bank_idle_cycles");
+    stats_.rank_active_cycles = simple_stats_.GetVecStat("rank_active_cycles");
+    stats_.read_latency = simple_stats_.GetHistoStat("read_latency");
+    stats_.write_latency = simple_stats_.GetHistoStat("write_latency");
+    stats_.interarrival_latency =
+        simple_stats_.GetHistoStat("interarrival_latency");
+}
+
 void Controller::UpdateCommandStats(const Command &cmd) {
+    PROFILE_SCOPE(STATS);
     switch (cmd.cmd_type) {
         case CommandType::READ:
         case CommandType::READ_PRECHARGE:
-            simple_stats_.Increment("num_read_cmds");
+            simple_stats_.Increment(stats_.num_read_cmds);
             if (channel_state_.RowHitCount(cmd.Rank(), cmd.Bankgroup(),
                                            cmd.Bank()) != 0) {
-                simple_stats_.Increment("num_read_row_hits");
+                simple_stats_.Increment(stats_.num_read_row_hits);
             }
             break;
         case CommandType::WRITE:
         case CommandType::WRITE_PRECHARGE:
-            simple_stats_.Increment("num_write_cmds");
+            simple_stats_.Increment(stats_.num_write_cmds);
             if (channel_state_.RowHitCount(cmd.Rank(), cmd.Bankgroup(),
                                            cmd.Bank()) != 0) {
-                simple_stats_.Increment("num_write_row_hits");
+                simple_stats_.Increment(stats_.num_write_row_hits);
             }
             break;
         case CommandType::ACTIVATE:
-            simple_stats_.Increment("num_act_cmds");
+            simple_stats_.Increment(stats_.num_act_cmds);
             break;
         case CommandType::PRECHARGE:
-            simple_stats_.Increment("num_pre_cmds");
+            simple_stats_.Increment(stats_.num_pre_cmds);
             break;
         case CommandType::REFRESH:
-            simple_stats_.Increment("num_ref_cmds");
+            simple_stats_.Increment(stats_.num_ref_cmds);
             break;
         case CommandType::REFRESH_BANK:
-            simple_stats_.Increment("num_refb_cmds");
+            simple_stats_.Increment(stats_.num_refb_cmds);
             break;
         case CommandType::SREF_ENTER:
-            simple_stats_.Increment("num_srefe_cmds");
+            simple_stats_.Increment(stats_.num_srefe_cmds);
             break;
         case CommandType::SREF_EXIT:
-            simple_stats_.Increment("num_srefx_cmds");
+            simple_stats_.Increment(stats_.num_srefx_cmds);
             break;
         default:
             AbruptExit(__FILE__, __LINE__);
     }
 }
 
+void Controller::SaveState(CheckpointWriter &ckpt) const {
+    ckpt.Put(clk_);
+    simple_stats_.SaveState(ckpt);
+    channel_state_.SaveState(ckpt);
+    cmd_queue_.SaveState(ckpt);
+    refresh_.SaveState(ckpt);
+    ckpt.Put(unified_queue_);
+    ckpt.Put(read_queue_);
+    ckpt.Put(write_buffer_);
+    pending_rd_q_.SaveState(ckpt);
+    pending_wr_q_.SaveState(ckpt);
+    // the heap as is so ties still come out in completion order
+    ckpt.Put(static_cast<uint64_t>(return_queue_.size()));
+    for (const auto &done : return_queue_) {
+        ckpt.Put(done.seq);
+        ckpt.Put(done.trans);
+    }
+    ckpt.Put(return_seq_);
+    ckpt.Put(last_trans_clk_);
+    ckpt.Put(write_draining_);
+}
+
+void Controller::RestoreState(CheckpointReader &ckpt) {
+    ckpt.Get(clk_);
+    simple_stats_.RestoreState(ckpt);
+    channel_state_.RestoreState(ckpt);
+    cmd_queue_.RestoreState(ckpt);
+    refresh_.RestoreState(ckpt);
+    ckpt.Get(unified_queue_);
+    ckpt.Get(read_queue_);
+    ckpt.Get(write_buffer_);
+    pending_rd_q_.RestoreState(ckpt);
+    pending_wr_q_.RestoreState(ckpt);
+    return_queue_.resize(ckpt.GetSize());
+    for (auto &done : return_queue_) {
+        ckpt.Get(done.seq);
+        ckpt.Get(done.trans);
+    }
+    ckpt.Get(return_seq_);
+    ckpt.Get(last_trans_clk_);
+    ckpt.Get(write_draining_);
+    // queue sizes come from the config, a snapshot with more queued than
+    // they hold does not fit
+    if (unified_queue_.size() > trans_queue_size_ ||
+        read_queue_.size() > trans_queue_size_ ||
+        write_buffer_.size() > trans_queue_size_) {
+        ckpt.Fail();
+    }
+    quiescent_ = false;
+    schedule_blocked_ = false;
+}
+
+size_t Controller::RetagInFlight(uint64_t tag) {
+    auto retag = [tag](Transaction &trans) { trans.tag = tag; };
+    pending_rd_q_.ForEach(retag);
+    pending_wr_q_.ForEach(retag);
+    for (auto &done : return_queue_) {
+        retag(done.trans);
+    }
+    return pending_rd_q_.Size() + return_queue_.size();
+}
+
 }  // namespace dramsim3
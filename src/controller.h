@@ -2,14 +2,15 @@
 #define __CONTROLLER_H
 
 #include <fstream>
-#include <map>
 #include <unordered_set>
 #include <vector>
 #include "channel_state.h"
+#include "checkpoint.h"
 #include "command_queue.h"
 #include "common.h"
 #include "refresh.h"
 #include "simple_stats.h"
+#include "transaction_table.h"
 
 #ifdef THERMAL
 #include "thermal.h"
@@ -32,10 +33,41 @@ class Controller {
     bool AddTransaction(Transaction trans);
     int QueueUsage() const;
     // Stats output
-    void PrintEpochStats();
+    void PrintEpochStats(StatsWriter& json_out, ColumnWriter& column_out);
     void PrintFinalStats();
     void ResetStats() { simple_stats_.Reset(); }
+    // return one transaction done by clock as (address, is_write), or
+    // (-1, -1) if there is none, transactions due in the same cycle come out
+    // in the order they were completed
     std::pair<uint64_t, int> ReturnDoneTrans(uint64_t clock);
+    // append all transactions done by clock to done in the same order as
+    // above, returns how many were appended
+    size_t ReturnDoneTrans(uint64_t clock, std::vector<Transaction> &done);
+
+    // Event driven simulation: the earliest cycle at which ClockTick or
+    // ReturnDoneTrans could do anything other than idle bookkeeping
+    uint64_t NextEventCycle() const;
+    // Catch up with clk by doing the idle bookkeeping in one go, only valid
+    // while clk is no later than NextEventCycle()
+    void FastForward(uint64_t clk);
+
+    // Functional fast-forward for sampled simulation, only valid with
+    // nothing queued or in flight. FunctionalSkip moves to clk without
+    // scheduling or counting anything except that refreshes due on the way
+    // are applied to the bank states, FunctionalAccess opens and closes
+    // rows the way trans would, in no time.
+    void FunctionalSkip(uint64_t clk);
+    void FunctionalAccess(const Transaction &trans);
+
+    // Everything the controller would go on from, queues, pending and
+    // completed transactions, channel and refresh state and stats. Cached
+    // scheduling hints are not saved, a restored controller looks at
+    // everything again on its next tick. Thermal state is not included.
+    void SaveState(CheckpointWriter &ckpt) const;
+    void RestoreState(CheckpointReader &ckpt);
+    // give every transaction not returned yet the tag tag, returns how many
+    // are still to come back (queued writes already have)
+    size_t RetagInFlight(uint64_t tag);
 
     int channel_id_;
 
@@ -51,22 +83,52 @@ class Controller {
     ThermalCalculator &thermal_calc_;
 #endif  // THERMAL
 
-    // queue that takes transactions from CPU side
+    // queue that takes transactions from CPU side, transactions are decoded
+    // into their commands once when queued instead of on every schedule scan
     bool is_unified_queue_;
-    std::vector<Transaction> unified_queue_;
-    std::vector<Transaction> read_queue_;
-    std::vector<Transaction> write_buffer_;
+    size_t trans_queue_size_;
+    std::vector<Command> unified_queue_;
+    std::vector<Command> read_queue_;
+    std::vector<Command> write_buffer_;
 
-    // transactions that are not completed, use map for convenience
-    std::multimap<uint64_t, Transaction> pending_rd_q_;
-    std::multimap<uint64_t, Transaction> pending_wr_q_;
+    // transactions that are not completed, keyed by address
+    TransactionTable pending_rd_q_;
+    TransactionTable pending_wr_q_;
 
-    // completed transactions
-    std::vector<Transaction> return_queue_;
+    // completed transactions, a min-heap on complete_cycle with ties broken
+    // by the order they were completed in
+    struct DoneTrans {
+        uint64_t seq;
+        Transaction trans;
+    };
+    struct DoneTransLater {
+        bool operator()(const DoneTrans &a, const DoneTrans &b) const {
+            return a.trans.complete_cycle != b.trans.complete_cycle
+                       ? a.trans.complete_cycle > b.trans.complete_cycle
+                       : a.seq > b.seq;
+        }
+    };
+    std::vector<DoneTrans> return_queue_;
+    uint64_t return_seq_;
+    void PushDoneTrans(const Transaction &trans);
+    Transaction PopDoneTrans();
 
     // row buffer policy
     RowBufPolicy row_buf_policy_;
 
+    // stats are looked up by name once here instead of on every update
+    struct StatHandles {
+        StatHandle num_cycles, epoch_num;
+        StatHandle num_reads_done, num_writes_done, hbm_dual_cmds;
+        StatHandle num_read_cmds, num_write_cmds, num_act_cmds, num_pre_cmds;
+        StatHandle num_ref_cmds, num_refb_cmds, num_srefe_cmds, num_srefx_cmds;
+        StatHandle num_read_row_hits, num_write_row_hits;
+        VecStatHandle sref_cycles, all_bank_idle_cycles, rank_active_cycles;
+        HistoStatHandle read_latency, write_latency, interarrival_latency;
+    };
+    StatHandles stats_;
+    void InitStatHandles();
+
 #ifdef CMD_TRACE
     std::ofstream cmd_trace_;
 #endif  // CMD_TRACE
@@ -74,6 +136,14 @@ class Controller {
     // used to calculate inter-arrival latency
     uint64_t last_trans_clk_;
 
+    // whether last tick did not issue or schedule anything, in which case the
+    // following ticks cannot either until timing or refresh says otherwise
+    bool quiescent_;
+
+    // whether the last ScheduleTransaction could not move anything and none
+    // of the queues it looks at have changed since, so it would not either
+    bool schedule_blocked_;
+
     // transaction queueing
     int write_draining_;
     void ScheduleTransaction();
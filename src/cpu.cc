@@ -1,5 +1,10 @@
 #include "cpu.h"
 
+#include <sys/stat.h>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
 namespace dramsim3 {
 
 void RandomCPU::ClockTick() {
@@ -61,32 +66,305 @@ void StreamCPU::ClockTick() {
 
 TraceBasedCPU::TraceBasedCPU(const std::string& config_file,
                              const std::string& output_dir,
-                             const std::string& trace_file)
-    : CPU(config_file, output_dir) {
-    trace_file_.open(trace_file);
-    if (trace_file_.fail()) {
-        std::cerr << "Trace file does not exist" << std::endl;
-        AbruptExit(__FILE__, __LINE__);
-    }
-}
+                             const std::string& trace_file, bool closed_loop,
+                             std::unique_ptr<Sampler> sampler)
+    : TraceBasedCPU(config_file, output_dir, OpenTraceReader(trace_file),
+                    closed_loop, std::move(sampler)) {}
+
+TraceBasedCPU::TraceBasedCPU(const std::string& config_file,
+                             const std::string& output_dir,
+                             std::unique_ptr<TraceReader> trace,
+                             bool closed_loop, std::unique_ptr<Sampler> sampler)
+    : CPU(config_file, output_dir),
+      trace_(std::move(trace)),
+      closed_loop_(closed_loop),
+      sampler_(std::move(sampler)) {}
 
 void TraceBasedCPU::ClockTick() {
+    // once the detailed part of an interval has drained, skip over the
+    // functional part in one go
+    bool functional_next =
+        sampler_ && get_next_ && !trace_done_ &&
+        sampler_->PhaseOf(num_fetched_) == Sampler::Phase::FUNCTIONAL;
+    if (functional_next && outstanding_ == 0 && restored_in_flight_ == 0) {
+        sampler_->CloseWindow();
+        SkipFunctional();
+        return;
+    }
     memory_system_.ClockTick();
-    if (!trace_file_.eof()) {
+    if (!trace_done_ && !functional_next) {
         if (get_next_) {
             get_next_ = false;
-            trace_file_ >> trans_;
+            FetchNext();
         }
-        if (trans_.added_cycle <= clk_) {
+        if (!trace_done_ && IsReady()) {
             get_next_ = memory_system_.WillAcceptTransaction(trans_.addr,
                                                              trans_.is_write);
             if (get_next_) {
-                memory_system_.AddTransaction(trans_.addr, trans_.is_write);
+                if (measured_) {
+                    sampler_->Issued(clk_);
+                    memory_system_.AddTransaction(
+                        trans_.addr, trans_.is_write, clk_ | kMeasuredTag);
+                } else {
+                    memory_system_.AddTransaction(trans_.addr, trans_.is_write);
+                }
+                last_issue_clk_ = clk_;
+                outstanding_++;
+                if (!trans_.is_write) {
+                    outstanding_reads_++;
+                }
+            }
+        }
+    }
+    clk_++;
+    return;
+}
+
+bool TraceBasedCPU::FetchNext() {
+    trace_done_ = !trace_->Next(trans_, depends_);
+    if (trace_done_) {
+        return false;
+    }
+    // out of order timestamps mean no gap
+    gap_ = trans_.added_cycle > last_trace_cycle_
+               ? trans_.added_cycle - last_trace_cycle_
+               : 0;
+    last_trace_cycle_ = trans_.added_cycle;
+    measured_ = sampler_ && sampler_->PhaseOf(num_fetched_) ==
+                                Sampler::Phase::MEASURE;
+    num_fetched_++;
+    return true;
+}
+
+void TraceBasedCPU::SkipFunctional() {
+    // transactions still issue when they would but only open and close rows,
+    // DEP markers have nothing to wait for
+    while (sampler_->PhaseOf(num_fetched_) == Sampler::Phase::FUNCTIONAL &&
+           FetchNext()) {
+        uint64_t issue_clk =
+            closed_loop_ ? last_issue_clk_ + gap_ : trans_.added_cycle;
+        clk_ = std::max(clk_, issue_clk);
+        memory_system_.FunctionalSkip(clk_);
+        memory_system_.FunctionalAccess(trans_.addr, trans_.is_write);
+        last_issue_clk_ = clk_;
+    }
+}
+
+void TraceBasedCPU::Complete(const MemoryRequest* done, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        // the restored ones are not in any of the counts
+        if (done[i].tag == kRestoredTag) {
+            restored_in_flight_--;
+            continue;
+        }
+        outstanding_--;
+        if (!done[i].is_write) {
+            outstanding_reads_--;
+            if (outstanding_reads_ == 0) {
+                reads_done_clk_ = clk_;
+            }
+        }
+        if (done[i].tag & kMeasuredTag) {
+            uint64_t issue_clk = done[i].tag & ~kMeasuredTag;
+            sampler_->Completed(done[i].is_write, clk_ - issue_clk, clk_);
+        }
+    }
+}
+
+void TraceBasedCPU::PrintStats() {
+    CPU::PrintStats();
+    if (sampler_) {
+        sampler_->CloseWindow();
+        uint64_t bytes_per_trans = memory_system_.GetBusBits() / 8 *
+                                   memory_system_.GetBurstLength();
+        memory_system_.AppendStats(
+            "sampling",
+            sampler_->Stats(bytes_per_trans, memory_system_.GetTCK()));
+    }
+}
+
+bool TraceBasedCPU::IsReady() const {
+    if (!closed_loop_) {
+        return trans_.added_cycle <= clk_;
+    }
+    uint64_t base_clk = last_issue_clk_;
+    if (depends_) {
+        if (outstanding_reads_ > 0) {
+            return false;
+        }
+        base_clk = std::max(base_clk, reads_done_clk_);
+    }
+    return base_clk + gap_ <= clk_;
+}
+
+MultiTraceCPU::MultiTraceCPU(const std::string& config_file,
+                             const std::string& output_dir,
+                             const std::vector<std::string>& trace_specs)
+    : CPU(config_file, output_dir) {
+    for (const auto& spec : trace_specs) {
+        auto fields = StringSplit(spec, ',');
+        if (fields.empty() || fields.size() > 3 || fields[0].empty()) {
+            std::cerr << "Bad trace spec " << spec
+                      << ", expecting file[,max_outstanding[,addr_offset]]"
+                      << std::endl;
+            AbruptExit(__FILE__, __LINE__);
+        }
+        TraceStream stream;
+        stream.trace = OpenTraceReader(fields[0]);
+        stream.max_outstanding = 0;
+        stream.addr_offset = 0;
+        stream.outstanding = 0;
+        try {
+            if (fields.size() > 1 && !fields[1].empty()) {
+                stream.max_outstanding = std::stoi(fields[1]);
+            }
+            if (fields.size() > 2 && !fields[2].empty()) {
+                stream.addr_offset = std::stoull(fields[2], nullptr, 0);
             }
+        } catch (const std::logic_error&) {
+            std::cerr << "Bad number in trace spec " << spec << std::endl;
+            AbruptExit(__FILE__, __LINE__);
         }
+        streams_.push_back(std::move(stream));
+    }
+    for (size_t i = 0; i < streams_.size(); i++) {
+        PushNext(static_cast<int>(i));
+    }
+}
+
+void MultiTraceCPU::PushNext(int stream) {
+    StreamHead head;
+    head.stream = stream;
+    if (streams_[stream].trace->Next(head.trans)) {
+        head.trans.addr += streams_[stream].addr_offset;
+        heads_.push_back(head);
+        std::push_heap(heads_.begin(), heads_.end(), StreamHead::Later);
     }
+}
+
+void MultiTraceCPU::ClockTick() {
+    memory_system_.ClockTick();
+    while (!heads_.empty() && heads_.front().trans.added_cycle <= clk_) {
+        std::pop_heap(heads_.begin(), heads_.end(), StreamHead::Later);
+        StreamHead head = heads_.back();
+        heads_.pop_back();
+        TraceStream& stream = streams_[head.stream];
+        const Transaction& trans = head.trans;
+        if ((stream.max_outstanding > 0 &&
+             stream.outstanding >= stream.max_outstanding) ||
+            !memory_system_.WillAcceptTransaction(trans.addr, trans.is_write)) {
+            // stalled, try again next cycle
+            stalled_.push_back(head);
+            continue;
+        }
+        memory_system_.AddTransaction(trans.addr, trans.is_write, head.stream);
+        stream.outstanding++;
+        issued_.push_back(head.stream);
+    }
+    for (const auto& head : stalled_) {
+        heads_.push_back(head);
+        std::push_heap(heads_.begin(), heads_.end(), StreamHead::Later);
+    }
+    for (int stream : issued_) {
+        PushNext(stream);
+    }
+    stalled_.clear();
+    issued_.clear();
     clk_++;
     return;
 }
 
+void MultiTraceCPU::Complete(const MemoryRequest* done, size_t count) {
+    // transactions are tagged with the stream that issued them
+    for (size_t i = 0; i < count; i++) {
+        if (done[i].tag != kRestoredTag) {
+            streams_[done[i].tag].outstanding--;
+        }
+    }
+}
+
+namespace {
+// chunks a config may run ahead of the slowest one on its own thread
+const size_t kSweepMaxChunks = 64;
+}  // namespace
+
+SweepCPU::SweepCPU(const std::vector<std::string>& config_files,
+                   const std::string& output_dir,
+                   const std::string& trace_file, bool closed_loop,
+                   const Sampler* sampler, bool threads)
+    : threads_(threads),
+      fanout_(new TraceFanout(OpenTraceReader(trace_file),
+                              config_files.size(),
+                              threads ? kSweepMaxChunks : 0)) {
+    for (size_t i = 0; i < config_files.size(); i++) {
+        // configs/DDR4_8Gb_x8_2400.ini writes to output_dir/DDR4_8Gb_x8_2400
+        std::string name = config_files[i];
+        name = name.substr(name.find_last_of('/') + 1);
+        name = name.substr(0, name.rfind(".ini"));
+        std::string config_dir = output_dir + "/" + name;
+        if (!DirExist(config_dir) && mkdir(config_dir.c_str(), 0755) != 0) {
+            std::cerr << "Cannot create output directory " << config_dir
+                      << std::endl;
+            AbruptExit(__FILE__, __LINE__);
+        }
+        std::unique_ptr<Sampler> config_sampler;
+        if (sampler) {
+            config_sampler.reset(new Sampler(*sampler));
+        }
+        names_.push_back(name);
+        cpus_.emplace_back(new TraceBasedCPU(config_files[i], config_dir,
+                                             fanout_->Reader(i), closed_loop,
+                                             std::move(config_sampler)));
+    }
+}
+
+void SweepCPU::Run(uint64_t cycles) {
+    auto done = [cycles](const TraceBasedCPU& cpu) {
+        return cpu.GetClk() >= cycles || cpu.Finished();
+    };
+    if (threads_) {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < cpus_.size(); i++) {
+            threads.emplace_back([this, i, &done] {
+                while (!done(*cpus_[i])) {
+                    cpus_[i]->ClockTick();
+                }
+                // the others must not wait for a config that stopped early
+                fanout_->Release(i);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        return;
+    }
+    std::vector<bool> released(cpus_.size(), false);
+    while (true) {
+        int next = -1;
+        for (size_t i = 0; i < cpus_.size(); i++) {
+            if (released[i]) {
+                continue;
+            }
+            if (done(*cpus_[i])) {
+                fanout_->Release(i);
+                released[i] = true;
+            } else if (next < 0 ||
+                       cpus_[i]->NumFetched() < cpus_[next]->NumFetched()) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        cpus_[next]->ClockTick();
+    }
+}
+
+void SweepCPU::PrintStats() {
+    for (size_t i = 0; i < cpus_.size(); i++) {
+        std::cout << "## " << names_[i] << std::endl;
+        cpus_[i]->PrintStats();
+    }
+}
+
 }  // namespace dramsim3
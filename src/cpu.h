@@ -1,30 +1,52 @@
 #ifndef __CPU_H
 #define __CPU_H
 
-#include <fstream>
-#include <functional>
+#include <memory>
 #include <random>
 #include <string>
+#include <vector>
 #include "memory_system.h"
+#include "sampling.h"
+#include "trace_reader.h"
 
 namespace dramsim3 {
 
-class CPU {
+// CPUs take their completions a cycle at a time as the memory system's
+// completion sink, the ones that do not care keep the empty Complete
+class CPU : public CompletionSink {
    public:
     CPU(const std::string& config_file, const std::string& output_dir)
-        : memory_system_(
-              config_file, output_dir,
-              std::bind(&CPU::ReadCallBack, this, std::placeholders::_1),
-              std::bind(&CPU::WriteCallBack, this, std::placeholders::_1)),
-          clk_(0) {}
+        : memory_system_(config_file, output_dir, nullptr, nullptr), clk_(0) {
+        memory_system_.RegisterCompletionSink(this);
+    }
+    virtual ~CPU() {}
     virtual void ClockTick() = 0;
-    void ReadCallBack(uint64_t addr) { return; }
-    void WriteCallBack(uint64_t addr) { return; }
-    void PrintStats() { memory_system_.PrintStats(); }
+    void Complete(const MemoryRequest* done, size_t count) override {}
+    virtual void PrintStats() { memory_system_.PrintStats(); }
+    uint64_t GetClk() const { return clk_; }
+    // nothing left to simulate, the ones that run forever never are
+    virtual bool Finished() const { return false; }
+    // only the memory system is saved, the CPU model starts over, and what
+    // was in flight comes back tagged kRestoredTag instead of a tag the CPU
+    // issued itself
+    bool SaveCheckpoint(const std::string& file) {
+        return memory_system_.SaveCheckpoint(file);
+    }
+    bool RestoreCheckpoint(const std::string& file) {
+        if (!memory_system_.RestoreCheckpoint(file)) {
+            return false;
+        }
+        restored_in_flight_ = memory_system_.RetagInFlight(kRestoredTag);
+        return true;
+    }
+    static const uint64_t kRestoredTag = ~0ull;
 
    protected:
     MemorySystem memory_system_;
     uint64_t clk_;
+    // restored transactions yet to complete, for the CPUs that wait for
+    // nothing to be in flight
+    size_t restored_in_flight_ = 0;
 };
 
 class RandomCPU : public CPU {
@@ -54,17 +76,122 @@ class StreamCPU : public CPU {
     const int stride_ = 64;                // stride in bytes
 };
 
+// Replays a trace open loop, each transaction at its added_cycle, or closed
+// loop: the differences between added_cycles become gaps counted from the
+// previous issue, and transactions marked DEP also wait for all earlier reads
+// to return, so stalls push the rest of the trace back.
+// With a sampler only the detailed parts of the trace go through the memory
+// system cycle by cycle, the functional parts are skipped over in one tick
+// and the run is finished once the trace is. The sampled stats are added to
+// the stats outputs.
 class TraceBasedCPU : public CPU {
    public:
     TraceBasedCPU(const std::string& config_file, const std::string& output_dir,
-                  const std::string& trace_file);
-    ~TraceBasedCPU() { trace_file_.close(); }
+                  const std::string& trace_file, bool closed_loop = false,
+                  std::unique_ptr<Sampler> sampler = nullptr);
+    TraceBasedCPU(const std::string& config_file, const std::string& output_dir,
+                  std::unique_ptr<TraceReader> trace, bool closed_loop = false,
+                  std::unique_ptr<Sampler> sampler = nullptr);
     void ClockTick() override;
+    void Complete(const MemoryRequest* done, size_t count) override;
+    void PrintStats() override;
+    bool Finished() const override {
+        return sampler_ && trace_done_ && outstanding_ == 0;
+    }
+    // transactions read from the trace so far
+    uint64_t NumFetched() const { return num_fetched_; }
 
    private:
-    std::ifstream trace_file_;
+    std::unique_ptr<TraceReader> trace_;
     Transaction trans_;
     bool get_next_ = true;
+    bool trace_done_ = false;
+    uint64_t num_fetched_ = 0;
+    int outstanding_ = 0;
+
+    bool closed_loop_;
+    bool depends_ = false;
+    uint64_t gap_ = 0;
+    uint64_t last_trace_cycle_ = 0;
+    uint64_t last_issue_clk_ = 0;
+    int outstanding_reads_ = 0;
+    uint64_t reads_done_clk_ = 0;
+
+    // measured transactions are tagged with their issue cycle and this bit
+    static const uint64_t kMeasuredTag = 1ull << 63;
+    std::unique_ptr<Sampler> sampler_;
+    bool measured_ = false;
+
+    bool IsReady() const;
+    bool FetchNext();
+    void SkipFunctional();
+};
+
+// Replays one trace per core, merged on added_cycle. Each trace is given as
+// "file[,max_outstanding[,addr_offset]]": a core stalls while it has
+// max_outstanding (0 for no limit) transactions in flight, like running out
+// of MSHRs, and addr_offset is added to its addresses to keep cores that
+// share a virtual address space apart.
+class MultiTraceCPU : public CPU {
+   public:
+    MultiTraceCPU(const std::string& config_file, const std::string& output_dir,
+                  const std::vector<std::string>& trace_specs);
+    void ClockTick() override;
+    void Complete(const MemoryRequest* done, size_t count) override;
+
+   private:
+    struct TraceStream {
+        std::unique_ptr<TraceReader> trace;
+        int max_outstanding;
+        uint64_t addr_offset;
+        int outstanding;
+    };
+    // head transaction of a stream waiting to be issued
+    struct StreamHead {
+        Transaction trans;
+        int stream;
+
+        // heap order, earliest added_cycle first and lower streams on ties
+        static bool Later(const StreamHead& a, const StreamHead& b) {
+            if (a.trans.added_cycle != b.trans.added_cycle) {
+                return a.trans.added_cycle > b.trans.added_cycle;
+            }
+            return a.stream > b.stream;
+        }
+    };
+
+    std::vector<TraceStream> streams_;
+    // min-heap of stream heads on (added_cycle, stream)
+    std::vector<StreamHead> heads_;
+    // heads to put back and streams to refill once this cycle is over, so a
+    // stream issues at most one transaction per cycle
+    std::vector<StreamHead> stalled_;
+    std::vector<int> issued_;
+
+    void PushNext(int stream);
+};
+
+// Replays one trace into one memory system per config, e.g. a sweep over
+// speed bins or timings. The trace is read and decoded once and fanned out
+// to a TraceBasedCPU per config, the stats of each config go to a
+// subdirectory of output_dir named after its config file. With threads every
+// config runs on a thread of its own, otherwise the config furthest behind in
+// the trace is ticked next so that little of the trace is buffered.
+class SweepCPU {
+   public:
+    SweepCPU(const std::vector<std::string>& config_files,
+             const std::string& output_dir, const std::string& trace_file,
+             bool closed_loop = false, const Sampler* sampler = nullptr,
+             bool threads = false);
+    // simulate every config for cycles cycles or until it is finished
+    void Run(uint64_t cycles);
+    void PrintStats();
+
+   private:
+    bool threads_;
+    std::vector<std::string> names_;
+    std::unique_ptr<TraceFanout> fanout_;
+    std::vector<std::unique_ptr<TraceBasedCPU>> cpus_;
 };
 
 }  // namespace dramsim3
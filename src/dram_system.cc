@@ -1,6 +1,13 @@
 #include "dram_system.h"
 
 #include <assert.h>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+#include "fmt/format.h"
+#include "json.hpp"
 
 namespace dramsim3 {
 
@@ -11,38 +18,217 @@ int BaseDRAMSystem::total_channels_ = 0;
 BaseDRAMSystem::BaseDRAMSystem(Config &config, const std::string &output_dir,
                                std::function<void(uint64_t)> read_callback,
                                std::function<void(uint64_t)> write_callback)
-    : read_callback_(read_callback),
-      write_callback_(write_callback),
-      last_req_clk_(0),
+    : last_req_clk_(0),
       config_(config),
       timing_(config_),
 #ifdef THERMAL
       thermal_calc_(config_),
 #endif  // THERMAL
-      clk_(0) {
+      clk_(0),
+      epoch_out_(config_.json_epoch_name),
+      epoch_columns_(config_.columnar_epoch_name),
+      callback_sink_(read_callback, write_callback),
+      sink_(&callback_sink_),
+      num_completed_(0) {
     total_channels_ += config_.channels;
 
+    int num_threads = std::min(config_.num_threads, config_.channels);
+    // more threads than cores only take turns waiting on each other
+    int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+    if (num_cores > 0) {
+        num_threads = std::min(num_threads, num_cores);
+    }
+#ifdef THERMAL
+    // all channels share one thermal calculator
+    num_threads = 1;
+#endif  // THERMAL
+    workers_ = new WorkerPool(num_threads);
+
 #ifdef ADDR_TRACE
     std::string addr_trace_name = config_.output_prefix + "addr.trace";
     address_trace_.open(addr_trace_name);
 #endif
 }
 
+BaseDRAMSystem::~BaseDRAMSystem() { delete (workers_); }
+
 int BaseDRAMSystem::GetChannel(uint64_t hex_addr) const {
     hex_addr >>= config_.shift_bits;
     return (hex_addr >> config_.ch_pos) & config_.ch_mask;
 }
 
-void BaseDRAMSystem::PrintEpochStats() {
-    // first epoch, print bracket
-    if (clk_ - config_.epoch_period == 0) {
-        std::ofstream epoch_out(config_.json_epoch_name, std::ofstream::out);
-        epoch_out << "[";
+size_t BaseDRAMSystem::AddTransactions(const MemoryRequest *requests,
+                                       size_t count) {
+    size_t num_added = 0;
+    while (num_added < count) {
+        const auto &req = requests[num_added];
+        if (!WillAcceptTransaction(req.addr, req.is_write)) {
+            break;
+        }
+        AddTransaction(req.addr, req.is_write, req.tag);
+        num_added++;
+    }
+    return num_added;
+}
+
+uint64_t BaseDRAMSystem::ClockTickUntil(uint64_t clk) {
+    uint64_t num_completed = num_completed_;
+    while (clk_ < clk && num_completed_ == num_completed) {
+        ClockTick();
+    }
+    return clk_;
+}
+
+void CallbackCompletionSink::Complete(const MemoryRequest *done,
+                                      size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const auto &req = done[i];
+        const auto &tagged_callback =
+            req.is_write ? tagged_write_callback : tagged_read_callback;
+        const auto &callback = req.is_write ? write_callback : read_callback;
+        if (tagged_callback) {
+            tagged_callback(req.addr, req.tag);
+        } else if (callback) {
+            callback(req.addr);
+        } else {
+            buffer_.push_back(req);
+        }
+    }
+}
+
+size_t CallbackCompletionSink::Drain(MemoryRequest *completions,
+                                     size_t capacity) {
+    size_t num_done = std::min(capacity, buffer_.size() - buffer_head_);
+    std::copy(buffer_.begin() + buffer_head_,
+              buffer_.begin() + buffer_head_ + num_done, completions);
+    buffer_head_ += num_done;
+    if (buffer_head_ == buffer_.size()) {
+        buffer_.clear();
+        buffer_head_ = 0;
+    }
+    return num_done;
+}
+
+void CallbackCompletionSink::SaveState(CheckpointWriter &ckpt) const {
+    ckpt.Put(static_cast<uint64_t>(buffer_.size() - buffer_head_));
+    for (size_t i = buffer_head_; i < buffer_.size(); i++) {
+        ckpt.Put(buffer_[i]);
+    }
+}
+
+void CallbackCompletionSink::RestoreState(CheckpointReader &ckpt) {
+    ckpt.Get(buffer_);
+    buffer_head_ = 0;
+}
+
+size_t CallbackCompletionSink::Retag(uint64_t tag) {
+    for (size_t i = buffer_head_; i < buffer_.size(); i++) {
+        buffer_[i].tag = tag;
+    }
+    return buffer_.size() - buffer_head_;
+}
+
+namespace {
+// what a snapshot and the system it is restored into must agree on
+std::vector<int> CheckpointShape(const Config &config) {
+    return {static_cast<int>(config.protocol), config.channels, config.ranks,
+            config.bankgroups, config.banks_per_group};
+}
+}  // namespace
+
+bool BaseDRAMSystem::SaveCheckpoint(const std::string &file) {
+    // catch up first so that every controller is saved as of clk_
+    FastForwardControllers();
+    std::ofstream out(file, std::ofstream::binary);
+    if (!out) {
+        std::cerr << "Cannot write checkpoint " << file << std::endl;
+        return false;
+    }
+    CheckpointWriter ckpt(out);
+    ckpt.PutBytes(kCheckpointMagic, kCheckpointMagicSize);
+    ckpt.Put(kCheckpointVersion);
+    ckpt.Put(CheckpointShape(config_));
+    SaveState(ckpt);
+    out.flush();
+    if (!ckpt.Ok()) {
+        std::cerr << "Failed writing checkpoint " << file << std::endl;
+        return false;
     }
+    return true;
+}
+
+bool BaseDRAMSystem::RestoreCheckpoint(const std::string &file) {
+    std::ifstream in(file, std::ifstream::binary);
+    if (!in) {
+        std::cerr << "Cannot read checkpoint " << file << std::endl;
+        return false;
+    }
+    CheckpointReader ckpt(in);
+    char magic[kCheckpointMagicSize];
+    ckpt.GetBytes(magic, kCheckpointMagicSize);
+    uint32_t version;
+    ckpt.Get(version);
+    if (!ckpt.Ok() ||
+        !std::equal(magic, magic + kCheckpointMagicSize, kCheckpointMagic) ||
+        version != kCheckpointVersion) {
+        std::cerr << file << " is not a version " << kCheckpointVersion
+                  << " checkpoint" << std::endl;
+        return false;
+    }
+    std::vector<int> shape;
+    ckpt.Get(shape);
+    if (shape != CheckpointShape(config_)) {
+        std::cerr << file << " was saved from a system of a different "
+                  << "protocol or organization" << std::endl;
+        return false;
+    }
+    RestoreState(ckpt);
+    if (!ckpt.Ok()) {
+        std::cerr << "Corrupt or mismatching checkpoint " << file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void BaseDRAMSystem::SaveState(CheckpointWriter &ckpt) const {
+    ckpt.Put(clk_);
+    ckpt.Put(last_req_clk_);
+    callback_sink_.SaveState(ckpt);
+    ckpt.Put(static_cast<uint64_t>(ctrls_.size()));
+    for (const auto ctrl : ctrls_) {
+        ctrl->SaveState(ckpt);
+    }
+}
+
+void BaseDRAMSystem::RestoreState(CheckpointReader &ckpt) {
+    ckpt.Get(clk_);
+    ckpt.Get(last_req_clk_);
+    callback_sink_.RestoreState(ckpt);
+    ckpt.ExpectSize(ctrls_.size());
+    for (auto ctrl : ctrls_) {
+        ctrl->RestoreState(ckpt);
+    }
+}
+
+size_t BaseDRAMSystem::RetagInFlight(uint64_t tag) {
+    size_t num_in_flight = callback_sink_.Retag(tag);
+    for (auto ctrl : ctrls_) {
+        num_in_flight += ctrl->RetagInFlight(tag);
+    }
+    return num_in_flight;
+}
+
+void BaseDRAMSystem::FastForwardControllers() {
+    for (size_t i = 0; i < ctrls_.size(); i++) {
+        ctrls_[i]->FastForward(clk_);
+    }
+}
+
+void BaseDRAMSystem::PrintEpochStats() {
+    PROFILE_SCOPE(STATS);
+    FastForwardControllers();
     for (size_t i = 0; i < ctrls_.size(); i++) {
-        ctrls_[i]->PrintEpochStats();
-        std::ofstream epoch_out(config_.json_epoch_name, std::ofstream::app);
-        epoch_out << "," << std::endl;
+        ctrls_[i]->PrintEpochStats(epoch_out_, epoch_columns_);
     }
 #ifdef THERMAL
     thermal_calc_.PrintTransPT(clk_);
@@ -51,13 +237,9 @@ void BaseDRAMSystem::PrintEpochStats() {
 }
 
 void BaseDRAMSystem::PrintStats() {
-    // Finish epoch output, remove last comma and append ]
-    std::ofstream epoch_out(config_.json_epoch_name, std::ios_base::in |
-                                                         std::ios_base::out |
-                                                         std::ios_base::ate);
-    epoch_out.seekp(-2, std::ios_base::cur);
-    epoch_out.write("]", 1);
-    epoch_out.close();
+    FastForwardControllers();
+    epoch_out_.Flush();
+    epoch_columns_.Flush();
 
     std::ofstream json_out(config_.json_stats_name, std::ofstream::out);
     json_out << "{";
@@ -73,13 +255,67 @@ void BaseDRAMSystem::PrintStats() {
     }
     json_out.open(config_.json_stats_name, std::ofstream::app);
     json_out << "}";
+    json_out.close();
 
+#ifdef PROFILE
+    AppendStats("profile", ProfileStats());
+#endif  // PROFILE
 #ifdef THERMAL
     thermal_calc_.PrintFinalPT(clk_);
 #endif  // THERMAL
 }
 
+void BaseDRAMSystem::AppendStats(const std::string &section,
+                                 const std::vector<HostStat> &stats) {
+    // json_stats_name holds one object, put the section before its closing }
+    nlohmann::json j_section;
+    for (const auto &stat : stats) {
+        j_section[stat.name] = stat.value;
+    }
+    std::fstream json_out(config_.json_stats_name,
+                          std::ios_base::in | std::ios_base::out);
+    if (json_out) {
+        json_out.seekp(-1, std::ios_base::end);
+        json_out << ",\n\"" << section << "\":" << j_section << "}";
+    }
+
+    if (config_.output_level >= 1) {
+        std::ofstream txt_out(config_.txt_stats_name, std::ofstream::app);
+        txt_out << "###########################################\n## "
+                << section
+                << "\n###########################################\n";
+        for (const auto &stat : stats) {
+            txt_out << fmt::format("{:<30}{:^3}{:>12}{:>5}{}", stat.name,
+                                   " = ", stat.value, " # ", stat.description)
+                    << std::endl;
+        }
+    }
+}
+
+void BaseDRAMSystem::FunctionalSkip(uint64_t clk) {
+    FastForwardControllers();
+    while (clk_ < clk) {
+        // stop at epoch ends to print their stats
+        uint64_t epoch_end =
+            (clk_ / config_.epoch_period + 1) * config_.epoch_period;
+        uint64_t next_clk = std::min(clk, epoch_end);
+        for (size_t i = 0; i < ctrls_.size(); i++) {
+            ctrls_[i]->FunctionalSkip(next_clk);
+        }
+        clk_ = next_clk;
+        if (clk_ % config_.epoch_period == 0) {
+            PrintEpochStats();
+        }
+    }
+}
+
+void BaseDRAMSystem::FunctionalAccess(uint64_t hex_addr, bool is_write) {
+    Transaction trans(hex_addr, is_write);
+    ctrls_[GetChannel(hex_addr)]->FunctionalAccess(trans);
+}
+
 void BaseDRAMSystem::ResetStats() {
+    FastForwardControllers();
     for (size_t i = 0; i < ctrls_.size(); i++) {
         ctrls_[i]->ResetStats();
     }
@@ -88,15 +324,29 @@ void BaseDRAMSystem::ResetStats() {
 void BaseDRAMSystem::RegisterCallbacks(
     std::function<void(uint64_t)> read_callback,
     std::function<void(uint64_t)> write_callback) {
-    // TODO this should be propagated to controllers
-    read_callback_ = read_callback;
-    write_callback_ = write_callback;
+    callback_sink_.read_callback = read_callback;
+    callback_sink_.write_callback = write_callback;
+    sink_ = &callback_sink_;
+}
+
+void BaseDRAMSystem::RegisterTaggedCallbacks(TaggedCallback read_callback,
+                                             TaggedCallback write_callback) {
+    callback_sink_.tagged_read_callback = read_callback;
+    callback_sink_.tagged_write_callback = write_callback;
+    sink_ = &callback_sink_;
+}
+
+void BaseDRAMSystem::RegisterCompletionSink(CompletionSink *sink) {
+    sink_ = sink != nullptr ? sink : &callback_sink_;
 }
 
 JedecDRAMSystem::JedecDRAMSystem(Config &config, const std::string &output_dir,
                                  std::function<void(uint64_t)> read_callback,
                                  std::function<void(uint64_t)> write_callback)
-    : BaseDRAMSystem(config, output_dir, read_callback, write_callback) {
+    : BaseDRAMSystem(config, output_dir, read_callback, write_callback),
+      ctrl_event_clks_(config_.channels, 0),
+      next_event_clk_(0),
+      tick_ctrl_([this](size_t i) { TickController(i); }) {
     if (config_.IsHMC()) {
         std::cerr << "Initialized a memory system with an HMC config file!"
                   << std::endl;
@@ -125,41 +375,77 @@ bool JedecDRAMSystem::WillAcceptTransaction(uint64_t hex_addr,
     return ctrls_[channel]->WillAcceptTransaction(hex_addr, is_write);
 }
 
-bool JedecDRAMSystem::AddTransaction(uint64_t hex_addr, bool is_write) {
-// Record trace - Record address trace for debugging or other purposes
-#ifdef ADDR_TRACE
-    address_trace_ << std::hex << hex_addr << std::dec << " "
-                   << (is_write ? "WRITE " : "READ ") << clk_ << std::endl;
-#endif
-
+bool JedecDRAMSystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                     uint64_t tag) {
     int channel = GetChannel(hex_addr);
     bool ok = ctrls_[channel]->WillAcceptTransaction(hex_addr, is_write);
 
     assert(ok);
     if (ok) {
-        Transaction trans = Transaction(hex_addr, is_write);
-        ctrls_[channel]->AddTransaction(trans);
+        AddToChannel(channel, hex_addr, is_write, tag);
     }
     last_req_clk_ = clk_;
     return ok;
 }
 
+size_t JedecDRAMSystem::AddTransactions(const MemoryRequest *requests,
+                                        size_t count) {
+    size_t num_added = 0;
+    while (num_added < count) {
+        const auto &req = requests[num_added];
+        int channel = GetChannel(req.addr);
+        if (!ctrls_[channel]->WillAcceptTransaction(req.addr, req.is_write)) {
+            break;
+        }
+        AddToChannel(channel, req.addr, req.is_write, req.tag);
+        num_added++;
+    }
+    if (num_added > 0) {
+        last_req_clk_ = clk_;
+    }
+    return num_added;
+}
+
+void JedecDRAMSystem::AddToChannel(int channel, uint64_t hex_addr,
+                                   bool is_write, uint64_t tag) {
+// Record trace - Record address trace for debugging or other purposes
+#ifdef ADDR_TRACE
+    address_trace_ << std::hex << hex_addr << std::dec << " "
+                   << (is_write ? "WRITE " : "READ ") << clk_ << std::endl;
+#endif
+
+    Transaction trans = Transaction(hex_addr, is_write, tag);
+    ctrls_[channel]->FastForward(clk_);
+    ctrls_[channel]->AddTransaction(trans);
+    ctrl_event_clks_[channel] = clk_;
+    next_event_clk_ = std::min(next_event_clk_, clk_);
+}
+
 void JedecDRAMSystem::ClockTick() {
+    if (clk_ < next_event_clk_) {
+        // nothing can happen in any channel, controllers catch up later
+        clk_++;
+        if (clk_ % config_.epoch_period == 0) {
+            PrintEpochStats();
+        }
+        return;
+    }
     for (size_t i = 0; i < ctrls_.size(); i++) {
+        if (ctrl_event_clks_[i] > clk_) {
+            continue;
+        }
+        ctrls_[i]->FastForward(clk_);
         // look ahead and return earlier
-        while (true) {
-            auto pair = ctrls_[i]->ReturnDoneTrans(clk_);
-            if (pair.second == 1) {
-                write_callback_(pair.first);
-            } else if (pair.second == 0) {
-                read_callback_(pair.first);
-            } else {
-                break;
-            }
+        done_trans_.clear();
+        ctrls_[i]->ReturnDoneTrans(clk_, done_trans_);
+        for (const auto &trans : done_trans_) {
+            CompleteTransaction(trans.addr, trans.is_write, trans.tag);
         }
     }
-    for (size_t i = 0; i < ctrls_.size(); i++) {
-        ctrls_[i]->ClockTick();
+    FlushCompletions();
+    workers_->Run(ctrls_.size(), tick_ctrl_);
+    if (config_.event_driven) {
+        UpdateEventClocks();
     }
     clk_++;
 
@@ -169,6 +455,65 @@ void JedecDRAMSystem::ClockTick() {
     return;
 }
 
+uint64_t JedecDRAMSystem::ClockTickUntil(uint64_t clk) {
+    uint64_t num_completed = num_completed_;
+    while (clk_ < clk && num_completed_ == num_completed) {
+        uint64_t next_clk = next_event_clk_;
+        if (!config_.event_driven) {
+            // every controller was ticked last cycle so they can tell
+            next_clk = std::numeric_limits<uint64_t>::max();
+            for (size_t i = 0; i < ctrls_.size(); i++) {
+                next_clk = std::min(next_clk, ctrls_[i]->NextEventCycle());
+            }
+        }
+        if (next_clk <= clk_) {
+            ClockTick();
+            continue;
+        }
+        // nothing happens until next_clk, controllers catch up when they
+        // are ticked next, stop at epoch ends to print their stats
+        uint64_t epoch_end =
+            (clk_ / config_.epoch_period + 1) * config_.epoch_period;
+        clk_ = std::min(std::min(next_clk, clk), epoch_end);
+        if (clk_ % config_.epoch_period == 0) {
+            PrintEpochStats();
+        }
+    }
+    return clk_;
+}
+
+void JedecDRAMSystem::RestoreState(CheckpointReader &ckpt) {
+    BaseDRAMSystem::RestoreState(ckpt);
+    // restored controllers have not worked out when they are due next, tick
+    // all of them once, which is what cycle by cycle mode does anyway
+    std::fill(ctrl_event_clks_.begin(), ctrl_event_clks_.end(), clk_);
+    next_event_clk_ = clk_;
+}
+
+void JedecDRAMSystem::FunctionalSkip(uint64_t clk) {
+    BaseDRAMSystem::FunctionalSkip(clk);
+    // the controllers were changed behind the event clocks' back
+    std::fill(ctrl_event_clks_.begin(), ctrl_event_clks_.end(), clk_);
+    next_event_clk_ = clk_;
+}
+
+void JedecDRAMSystem::TickController(size_t i) {
+    if (ctrl_event_clks_[i] > clk_) {
+        return;
+    }
+    ctrls_[i]->ClockTick();
+    if (config_.event_driven) {
+        ctrl_event_clks_[i] = ctrls_[i]->NextEventCycle();
+    }
+}
+
+void JedecDRAMSystem::UpdateEventClocks() {
+    next_event_clk_ = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < ctrls_.size(); i++) {
+        next_event_clk_ = std::min(next_event_clk_, ctrl_event_clks_[i]);
+    }
+}
+
 IdealDRAMSystem::IdealDRAMSystem(Config &config, const std::string &output_dir,
                                  std::function<void(uint64_t)> read_callback,
                                  std::function<void(uint64_t)> write_callback)
@@ -177,8 +522,9 @@ IdealDRAMSystem::IdealDRAMSystem(Config &config, const std::string &output_dir,
 
 IdealDRAMSystem::~IdealDRAMSystem() {}
 
-bool IdealDRAMSystem::AddTransaction(uint64_t hex_addr, bool is_write) {
-    auto trans = Transaction(hex_addr, is_write);
+bool IdealDRAMSystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                     uint64_t tag) {
+    auto trans = Transaction(hex_addr, is_write, tag);
     trans.added_cycle = clk_;
     infinite_buffer_q_.push_back(trans);
     return true;
@@ -188,20 +534,35 @@ void IdealDRAMSystem::ClockTick() {
     for (auto trans_it = infinite_buffer_q_.begin();
          trans_it != infinite_buffer_q_.end();) {
         if (clk_ - trans_it->added_cycle >= static_cast<uint64_t>(latency_)) {
-            if (trans_it->is_write) {
-                write_callback_(trans_it->addr);
-            } else {
-                read_callback_(trans_it->addr);
-            }
+            CompleteTransaction(trans_it->addr, trans_it->is_write,
+                                trans_it->tag);
             trans_it = infinite_buffer_q_.erase(trans_it++);
         }
         if (trans_it != infinite_buffer_q_.end()) {
             ++trans_it;
         }
     }
+    FlushCompletions();
 
     clk_++;
     return;
 }
 
+void IdealDRAMSystem::SaveState(CheckpointWriter &ckpt) const {
+    BaseDRAMSystem::SaveState(ckpt);
+    ckpt.Put(infinite_buffer_q_);
+}
+
+void IdealDRAMSystem::RestoreState(CheckpointReader &ckpt) {
+    BaseDRAMSystem::RestoreState(ckpt);
+    ckpt.Get(infinite_buffer_q_);
+}
+
+size_t IdealDRAMSystem::RetagInFlight(uint64_t tag) {
+    for (auto &trans : infinite_buffer_q_) {
+        trans.tag = tag;
+    }
+    return BaseDRAMSystem::RetagInFlight(tag) + infinite_buffer_q_.size();
+}
+
 }  // namespace dramsim3
@@ -5,10 +5,16 @@
 #include <string>
 #include <vector>
 
+#include "checkpoint.h"
 #include "common.h"
+#include "completion_sink.h"
 #include "configuration.h"
 #include "controller.h"
+#include "memory_request.h"
+#include "profiler.h"
+#include "stats_writer.h"
 #include "timing.h"
+#include "worker_pool.h"
 
 #ifdef THERMAL
 #include "thermal.h"
@@ -16,25 +22,92 @@
 
 namespace dramsim3 {
 
+// The std::function callback interface as a completion sink. Tagged
+// callbacks take precedence over plain ones, completions with neither are
+// buffered for Drain.
+class CallbackCompletionSink : public CompletionSink {
+   public:
+    CallbackCompletionSink(std::function<void(uint64_t)> read_callback,
+                           std::function<void(uint64_t)> write_callback)
+        : read_callback(read_callback),
+          write_callback(write_callback),
+          buffer_head_(0) {}
+    void Complete(const MemoryRequest *done, size_t count) override;
+    size_t Drain(MemoryRequest *completions, size_t capacity);
+    // completions buffered for Drain, the callbacks belong to the host
+    void SaveState(CheckpointWriter &ckpt) const;
+    void RestoreState(CheckpointReader &ckpt);
+    // give the buffered completions the tag tag, returns how many there are
+    size_t Retag(uint64_t tag);
+
+    std::function<void(uint64_t req_id)> read_callback, write_callback;
+    TaggedCallback tagged_read_callback, tagged_write_callback;
+
+   private:
+    // oldest buffered completion at buffer_head_
+    std::vector<MemoryRequest> buffer_;
+    size_t buffer_head_;
+};
+
 class BaseDRAMSystem {
    public:
     BaseDRAMSystem(Config &config, const std::string &output_dir,
                    std::function<void(uint64_t)> read_callback,
                    std::function<void(uint64_t)> write_callback);
-    virtual ~BaseDRAMSystem() {}
+    virtual ~BaseDRAMSystem();
     void RegisterCallbacks(std::function<void(uint64_t)> read_callback,
                            std::function<void(uint64_t)> write_callback);
+    void RegisterTaggedCallbacks(TaggedCallback read_callback,
+                                 TaggedCallback write_callback);
+    // send completions to sink instead of the callbacks until callbacks are
+    // registered again, nullptr goes back to the callbacks right away
+    void RegisterCompletionSink(CompletionSink *sink);
     void PrintEpochStats();
     void PrintStats();
     void ResetStats();
 
     virtual bool WillAcceptTransaction(uint64_t hex_addr,
                                        bool is_write) const = 0;
-    virtual bool AddTransaction(uint64_t hex_addr, bool is_write) = 0;
+    virtual bool AddTransaction(uint64_t hex_addr, bool is_write,
+                                uint64_t tag) = 0;
+    // add requests in order up to the first one that is not accepted,
+    // returns how many were added
+    virtual size_t AddTransactions(const MemoryRequest *requests,
+                                   size_t count);
+    // move up to capacity buffered completions into completions oldest
+    // first, returns how many were moved
+    size_t DrainCompletions(MemoryRequest *completions, size_t capacity) {
+        return callback_sink_.Drain(completions, capacity);
+    }
     virtual void ClockTick() = 0;
+    // tick until clk or until a tick completes something, whichever comes
+    // first, returns the cycle reached
+    virtual uint64_t ClockTickUntil(uint64_t clk);
+    uint64_t GetClk() const { return clk_; }
     int GetChannel(uint64_t hex_addr) const;
 
-    std::function<void(uint64_t req_id)> read_callback_, write_callback_;
+    // Snapshot the whole state to file / restore it, see checkpoint.h for
+    // the format. Restoring needs a system built from a config of the same
+    // shape, other parameters may differ. Registered callbacks or sink stay
+    // as they are. Returns false (and says why on stderr) if the file cannot
+    // be written or is not a snapshot this system can restore, in which case
+    // a partially restored system is not usable.
+    bool SaveCheckpoint(const std::string &file);
+    bool RestoreCheckpoint(const std::string &file);
+    // give every transaction in flight, buffered completions included, the
+    // tag tag, for hosts that restore a snapshot they did not take. Returns
+    // how many completions are still to come.
+    virtual size_t RetagInFlight(uint64_t tag);
+
+    // Functional fast-forward for sampled simulation, see Controller. Only
+    // valid while nothing is in flight. Epoch stats are still printed.
+    virtual void FunctionalSkip(uint64_t clk);
+    void FunctionalAccess(uint64_t hex_addr, bool is_write);
+
+    // add a section of host stats to the final outputs after PrintStats
+    void AppendStats(const std::string &section,
+                     const std::vector<HostStat> &stats);
+
     static int total_channels_;
 
    protected:
@@ -52,6 +125,41 @@ class BaseDRAMSystem {
     uint64_t clk_;
     std::vector<Controller*> ctrls_;
 
+    // controllers do not share any state within a cycle so they can be
+    // ticked in parallel, callbacks are always made from the calling thread
+    WorkerPool *workers_;
+
+    // one JSON line / one row per channel and epoch
+    StatsWriter epoch_out_;
+    ColumnWriter epoch_columns_;
+
+    // bring controllers that skipped idle cycles up to date
+    void FastForwardControllers();
+
+    // the body of a snapshot, subclasses add their own state after this
+    virtual void SaveState(CheckpointWriter &ckpt) const;
+    virtual void RestoreState(CheckpointReader &ckpt);
+
+    // reused buffer for the transactions a controller returns in a cycle
+    std::vector<Transaction> done_trans_;
+
+    CallbackCompletionSink callback_sink_;
+    CompletionSink *sink_;
+    // transactions finished this cycle, handed to sink_ in one call
+    std::vector<MemoryRequest> done_batch_;
+    uint64_t num_completed_;
+    void CompleteTransaction(uint64_t addr, bool is_write, uint64_t tag) {
+        done_batch_.push_back(MemoryRequest{addr, is_write, tag});
+    }
+    void FlushCompletions() {
+        if (!done_batch_.empty()) {
+            PROFILE_SCOPE(CALLBACKS);
+            num_completed_ += done_batch_.size();
+            sink_->Complete(done_batch_.data(), done_batch_.size());
+            done_batch_.clear();
+        }
+    }
+
 #ifdef ADDR_TRACE
     std::ofstream address_trace_;
 #endif  // ADDR_TRACE
@@ -65,8 +173,31 @@ class JedecDRAMSystem : public BaseDRAMSystem {
                     std::function<void(uint64_t)> write_callback);
     ~JedecDRAMSystem();
     bool WillAcceptTransaction(uint64_t hex_addr, bool is_write) const override;
-    bool AddTransaction(uint64_t hex_addr, bool is_write) override;
+    bool AddTransaction(uint64_t hex_addr, bool is_write,
+                        uint64_t tag) override;
+    size_t AddTransactions(const MemoryRequest *requests,
+                           size_t count) override;
     void ClockTick() override;
+    // jumps over cycles in which no controller has anything to do, event
+    // driven mode or not
+    uint64_t ClockTickUntil(uint64_t clk) override;
+
+    void FunctionalSkip(uint64_t clk) override;
+
+   protected:
+    void RestoreState(CheckpointReader &ckpt) override;
+
+   private:
+    void AddToChannel(int channel, uint64_t hex_addr, bool is_write,
+                      uint64_t tag);
+
+    // event driven mode: controllers are only ticked from these cycles on,
+    // always due in cycle by cycle mode
+    std::vector<uint64_t> ctrl_event_clks_;
+    uint64_t next_event_clk_;
+    std::function<void(size_t)> tick_ctrl_;
+    void TickController(size_t i);
+    void UpdateEventClocks();
 };
 
 // Model a memorysystem with an infinite bandwidth and a fixed latency (possibly
@@ -82,8 +213,14 @@ class IdealDRAMSystem : public BaseDRAMSystem {
                                bool is_write) const override {
         return true;
     };
-    bool AddTransaction(uint64_t hex_addr, bool is_write) override;
+    bool AddTransaction(uint64_t hex_addr, bool is_write,
+                        uint64_t tag) override;
     void ClockTick() override;
+    size_t RetagInFlight(uint64_t tag) override;
+
+   protected:
+    void SaveState(CheckpointWriter &ckpt) const override;
+    void RestoreState(CheckpointReader &ckpt) override;
 
    private:
     int latency_;
@@ -0,0 +1,102 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace dramsim3 {
+
+Histogram::Histogram(HistoLayout layout, int max_value, int precision)
+    : layout_(layout),
+      max_value_(std::max(max_value, 0)),
+      precision_(std::min(std::max(precision, 0), 30)),
+      sub_buckets_(1 << precision_),
+      count_(0),
+      sum_(0),
+      max_(0) {
+    // +1 for the last covered value, +1 for the overflow cell
+    cells_.resize(CellIndex(max_value_) + 2, 0);
+}
+
+void Histogram::Add(const Histogram& other) {
+    for (size_t i = 0; i < cells_.size(); i++) {
+        cells_[i] += other.cells_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+void Histogram::Clear() {
+    std::fill(cells_.begin(), cells_.end(), 0);
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+}
+
+double Histogram::Mean() const {
+    return count_ == 0
+               ? 0.0
+               : static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+int Histogram::Percentile(double p) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p * count_));
+    rank = std::min(std::max(rank, static_cast<uint64_t>(1)), count_);
+    uint64_t accu_count = 0;
+    for (size_t i = 0; i < cells_.size(); i++) {
+        accu_count += cells_[i];
+        if (accu_count >= rank) {
+            return std::min(CellHighValue(i), max_);
+        }
+    }
+    return max_;
+}
+
+int Histogram::CellLowValue(size_t idx) const {
+    if (idx == cells_.size() - 1) {
+        return max_value_ == std::numeric_limits<int>::max() ? max_value_
+                                                             : max_value_ + 1;
+    }
+    int cell = static_cast<int>(idx);
+    if (layout_ == HistoLayout::LINEAR || cell < 2 * sub_buckets_) {
+        return cell;
+    }
+    int shift = cell / sub_buckets_ - 1;
+    return (cell - shift * sub_buckets_) << shift;
+}
+
+int Histogram::CellHighValue(size_t idx) const {
+    if (idx == cells_.size() - 1) {
+        return max_;
+    }
+    int cell = static_cast<int>(idx);
+    if (layout_ == HistoLayout::LINEAR || cell < 2 * sub_buckets_) {
+        return cell;
+    }
+    int shift = cell / sub_buckets_ - 1;
+    int64_t high = static_cast<int64_t>(CellLowValue(idx)) + (1LL << shift) - 1;
+    return static_cast<int>(std::min(high, static_cast<int64_t>(max_value_)));
+}
+
+void Histogram::SaveState(CheckpointWriter& ckpt) const {
+    ckpt.Put(cells_);
+    ckpt.Put(count_);
+    ckpt.Put(sum_);
+    ckpt.Put(max_);
+}
+
+void Histogram::RestoreState(CheckpointReader& ckpt) {
+    ckpt.ExpectSize(cells_.size());
+    for (auto& cell : cells_) {
+        ckpt.Get(cell);
+    }
+    ckpt.Get(count_);
+    ckpt.Get(sum_);
+    ckpt.Get(max_);
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,95 @@
+#ifndef __HISTOGRAM_H
+#define __HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "checkpoint.h"
+
+namespace dramsim3 {
+
+enum class HistoLayout { LINEAR, LOG_LINEAR, SIZE };
+
+// Histogram of non-negative integer samples that bins at insert time into a
+// flat array of cells, so adding a sample is an index computation and an
+// increment no matter how many distinct values have been seen.
+//
+// Both layouts cover [0, max_value] and count larger values in an overflow
+// cell. LINEAR has one cell per value. LOG_LINEAR (HDR histogram style) keeps
+// values below 2^(precision + 1) exact, larger values share cells that are
+// 1/2^precision of their magnitude wide, i.e. the relative error is bounded
+// by 2^-precision while the number of cells only grows with log(max_value).
+class Histogram {
+   public:
+    Histogram(HistoLayout layout, int max_value, int precision);
+
+    void AddValue(int value) {
+        if (value < 0) value = 0;
+        cells_[CellIndex(value)] += 1;
+        count_ += 1;
+        sum_ += static_cast<uint64_t>(value);
+        if (value > max_) max_ = value;
+    }
+
+    // merge the samples of a histogram with the same layout
+    void Add(const Histogram& other);
+    void Clear();
+
+    // samples only, the layout comes from the constructor
+    void SaveState(CheckpointWriter& ckpt) const;
+    void RestoreState(CheckpointReader& ckpt);
+
+    uint64_t Count() const { return count_; }
+    double Mean() const;
+    int Max() const { return max_; }
+    // smallest recorded value v such that at least fraction p of samples are
+    // no larger than v, exact for values that have a cell of their own and
+    // the upper end of the cell otherwise
+    int Percentile(double p) const;
+
+    // call f(lowest_value, count) for each non-empty cell in value order
+    template <typename F>
+    void ForEachCell(F f) const {
+        for (size_t i = 0; i < cells_.size(); i++) {
+            if (cells_[i] != 0) {
+                f(CellLowValue(i), cells_[i]);
+            }
+        }
+    }
+
+   private:
+    HistoLayout layout_;
+    int max_value_;
+    int precision_;
+    int sub_buckets_;
+    std::vector<uint64_t> cells_;
+    uint64_t count_;
+    uint64_t sum_;
+    int max_;
+
+    size_t CellIndex(int value) const {
+        if (value > max_value_) {
+            return cells_.size() - 1;
+        }
+        if (layout_ == HistoLayout::LINEAR || value < 2 * sub_buckets_) {
+            return value;
+        }
+        int shift = FloorLog2(value) - precision_;
+        return shift * sub_buckets_ + (value >> shift);
+    }
+    int CellLowValue(size_t idx) const;
+    int CellHighValue(size_t idx) const;
+
+    static int FloorLog2(uint32_t value) {
+#ifdef __GNUC__
+        return 31 - __builtin_clz(value);
+#else
+        int log = 0;
+        while (value >>= 1) log++;
+        return log;
+#endif
+    }
+};
+
+}  // namespace dramsim3
+#endif
@@ -1,9 +1,15 @@
 #include "hmc.h"
 
+#include <algorithm>
+
 namespace dramsim3 {
 
 HMCRequest::HMCRequest(HMCReqType req_type, uint64_t hex_addr, int vault)
-    : type(req_type), mem_operand(hex_addr), vault(vault) {
+    : type(req_type),
+      mem_operand(hex_addr),
+      vault(vault),
+      tag(0),
+      resp_slot(-1) {
     is_write = type >= HMCReqType::WR0 && type <= HMCReqType::P_WR256;
     // given that vaults could be 16 (Gen1) or 32(Gen2), using % 4
     // to partition vaults to quads
@@ -111,7 +117,7 @@ HMCRequest::HMCRequest(HMCReqType req_type, uint64_t hex_addr, int vault)
 
 HMCResponse::HMCResponse(uint64_t id, HMCReqType req_type, int dest_link,
                          int src_quad)
-    : resp_id(id), link(dest_link), quad(src_quad) {
+    : resp_id(id), link(dest_link), quad(src_quad), tag(0) {
     switch (req_type) {
         case HMCReqType::RD0:
             type = HMCRespType::RD_RS;
@@ -340,7 +346,8 @@ bool HMCMemorySystem::WillAcceptTransaction(uint64_t hex_addr,
     return insertable;
 }
 
-bool HMCMemorySystem::AddTransaction(uint64_t hex_addr, bool is_write) {
+bool HMCMemorySystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                     uint64_t tag) {
     // to be compatible with other protocol we have this interface
     // when using this intreface the size of each transaction will be block_size
     HMCReqType req_type;
@@ -391,6 +398,7 @@ bool HMCMemorySystem::AddTransaction(uint64_t hex_addr, bool is_write) {
     }
     int vault = GetChannel(hex_addr);
     HMCRequest *req = new HMCRequest(req_type, hex_addr, vault);
+    req->tag = tag;
     return InsertHMCReq(req);
 }
 
@@ -405,8 +413,14 @@ bool HMCMemorySystem::InsertReqToLink(HMCRequest *req, int link) {
         link_req_queues_[link].push_back(req);
         HMCResponse *resp =
             new HMCResponse(req->mem_operand, req->type, link, req->quad);
-        resp_lookup_table_.insert(
-            std::pair<uint64_t, HMCResponse *>(resp->resp_id, resp));
+        resp->tag = req->tag;
+        if (free_resp_slots_.empty()) {
+            free_resp_slots_.push_back(static_cast<int>(resp_slots_.size()));
+            resp_slots_.push_back(nullptr);
+        }
+        req->resp_slot = free_resp_slots_.back();
+        free_resp_slots_.pop_back();
+        resp_slots_[req->resp_slot] = resp;
         link_age_counter_[link] = 1;
         // stats_.interarrival_latency.AddValue(clk_ - last_req_clk_);
         last_req_clk_ = clk_;
@@ -497,16 +511,15 @@ void HMCMemorySystem::DrainResponses() {
         if (!link_resp_queues_[i].empty()) {
             HMCResponse *resp = link_resp_queues_[i].front();
             if (resp->exit_time <= logic_clk_) {
-                if (resp->type == HMCRespType::RD_RS) {
-                    read_callback_(resp->resp_id);
-                } else {
-                    write_callback_(resp->resp_id);
-                }
+                CompleteTransaction(resp->resp_id,
+                                    resp->type != HMCRespType::RD_RS,
+                                    resp->tag);
                 delete (resp);
                 link_resp_queues_[i].erase(link_resp_queues_[i].begin());
             }
         }
     }
+    FlushCompletions();
 
     // drain xbar
     for (auto &&i : link_busy_) {
@@ -544,20 +557,14 @@ void HMCMemorySystem::DrainResponses() {
 void HMCMemorySystem::DRAMClockTick() {
     for (size_t i = 0; i < ctrls_.size(); i++) {
         // look ahead and return earlier
-        while (true) {
-            auto pair = ctrls_[i]->ReturnDoneTrans(clk_);
-            if (pair.second == 1) {  // write
-                VaultCallback(pair.first);
-            } else if (pair.second == 0) {  // read
-                VaultCallback(pair.first);
-            } else {
-                break;
-            }
+        done_trans_.clear();
+        ctrls_[i]->ReturnDoneTrans(clk_, done_trans_);
+        for (const auto &trans : done_trans_) {
+            VaultCallback(static_cast<int>(trans.tag));
         }
     }
-    for (size_t i = 0; i < ctrls_.size(); i++) {
-        ctrls_[i]->ClockTick();
-    }
+    workers_->Run(ctrls_.size(),
+                  [this](size_t i) { ctrls_[i]->ClockTick(); });
     clk_++;
 
     if (clk_ % config_.epoch_period == 0) {
@@ -586,6 +593,20 @@ void HMCMemorySystem::ClockTick() {
     return;
 }
 
+void HMCMemorySystem::FunctionalSkip(uint64_t clk) {
+    uint64_t cycles = clk > clk_ ? clk - clk_ : 0;
+    BaseDRAMSystem::FunctionalSkip(clk);
+    // keep the logic clock where ClockTick would have left it, at or just
+    // past the DRAM clock
+    dram_ps_ += cycles * ps_per_dram_;
+    if (logic_ps_ < dram_ps_) {
+        uint64_t logic_cycles =
+            (dram_ps_ - logic_ps_ + ps_per_logic_ - 1) / ps_per_logic_;
+        logic_ps_ += logic_cycles * ps_per_logic_;
+        logic_clk_ += logic_cycles;
+    }
+}
+
 std::vector<int> HMCMemorySystem::BuildAgeQueue(std::vector<int> &age_counter) {
     // return a vector of indices sorted in decending order
     // meaning that the oldest age link/quad should be processed first
@@ -613,25 +634,253 @@ std::vector<int> HMCMemorySystem::BuildAgeQueue(std::vector<int> &age_counter) {
 }
 
 void HMCMemorySystem::InsertReqToDRAM(HMCRequest *req) {
-    Transaction trans(req->mem_operand, req->is_write);
+    Transaction trans(req->mem_operand, req->is_write, req->resp_slot);
     ctrls_[req->vault]->AddTransaction(trans);
     return;
 }
 
-void HMCMemorySystem::VaultCallback(uint64_t req_id) {
-    // we will use hex addr as the req_id and use a multimap to lookup the
-    // requests the vaults cannot directly talk to the CPU so this callback will
-    // be passed to the vaults and is responsible to put the responses back to
-    // response queues
-
-    auto it = resp_lookup_table_.find(req_id);
-    HMCResponse *resp = it->second;
+void HMCMemorySystem::VaultCallback(int resp_slot) {
+    // the vaults cannot directly talk to the CPU so this callback is
+    // responsible to put the responses back to response queues, the slot
+    // came down to the vault as the transaction tag
+    HMCResponse *resp = resp_slots_[resp_slot];
     // all data from dram received, put packet in xbar and return
-    resp_lookup_table_.erase(it);
+    resp_slots_[resp_slot] = nullptr;
+    free_resp_slots_.push_back(resp_slot);
     // put it in xbar
     quad_resp_queues_[resp->quad].push_back(resp);
     quad_age_counter_[resp->quad] = 1;
     return;
 }
 
+namespace {
+void PutRequests(CheckpointWriter &ckpt,
+                 const std::vector<std::vector<HMCRequest *>> &queues) {
+    ckpt.Put(static_cast<uint64_t>(queues.size()));
+    for (const auto &queue : queues) {
+        ckpt.Put(static_cast<uint64_t>(queue.size()));
+        for (const auto req : queue) {
+            ckpt.Put(static_cast<int>(req->type));
+            ckpt.Put(req->mem_operand);
+            ckpt.Put(req->link);
+            ckpt.Put(req->quad);
+            ckpt.Put(req->vault);
+            ckpt.Put(req->flits);
+            ckpt.Put(req->is_write);
+            ckpt.Put(req->tag);
+            ckpt.Put(req->resp_slot);
+            ckpt.Put(req->exit_time);
+        }
+    }
+}
+
+void GetRequests(CheckpointReader &ckpt,
+                 std::vector<std::vector<HMCRequest *>> &queues) {
+    ckpt.ExpectSize(queues.size());
+    for (auto &queue : queues) {
+        for (auto req : queue) {
+            delete (req);
+        }
+        queue.resize(ckpt.GetSize());
+        for (auto &req : queue) {
+            int type;
+            ckpt.Get(type);
+            if (type < 0 || type >= static_cast<int>(HMCReqType::SIZE)) {
+                ckpt.Fail();
+                type = 0;
+            }
+            uint64_t mem_operand;
+            ckpt.Get(mem_operand);
+            req = new HMCRequest(static_cast<HMCReqType>(type), mem_operand, 0);
+            ckpt.Get(req->link);
+            ckpt.Get(req->quad);
+            ckpt.Get(req->vault);
+            ckpt.Get(req->flits);
+            ckpt.Get(req->is_write);
+            ckpt.Get(req->tag);
+            ckpt.Get(req->resp_slot);
+            ckpt.Get(req->exit_time);
+        }
+    }
+}
+
+void PutResponse(CheckpointWriter &ckpt, const HMCResponse *resp) {
+    ckpt.Put(resp->resp_id);
+    ckpt.Put(static_cast<int>(resp->type));
+    ckpt.Put(resp->link);
+    ckpt.Put(resp->quad);
+    ckpt.Put(resp->flits);
+    ckpt.Put(resp->tag);
+    ckpt.Put(resp->exit_time);
+}
+
+HMCResponse *GetResponse(CheckpointReader &ckpt) {
+    // the constructor works out type and flits from the request type, which
+    // is not kept, so everything is overwritten
+    HMCResponse *resp = new HMCResponse(0, HMCReqType::RD0, 0, 0);
+    ckpt.Get(resp->resp_id);
+    int type;
+    ckpt.Get(type);
+    if (type < 0 || type >= static_cast<int>(HMCRespType::SIZE)) {
+        ckpt.Fail();
+        type = 0;
+    }
+    resp->type = static_cast<HMCRespType>(type);
+    ckpt.Get(resp->link);
+    ckpt.Get(resp->quad);
+    ckpt.Get(resp->flits);
+    ckpt.Get(resp->tag);
+    ckpt.Get(resp->exit_time);
+    return resp;
+}
+
+void PutResponses(CheckpointWriter &ckpt,
+                  const std::vector<std::vector<HMCResponse *>> &queues) {
+    ckpt.Put(static_cast<uint64_t>(queues.size()));
+    for (const auto &queue : queues) {
+        ckpt.Put(static_cast<uint64_t>(queue.size()));
+        for (const auto resp : queue) {
+            PutResponse(ckpt, resp);
+        }
+    }
+}
+
+void GetResponses(CheckpointReader &ckpt,
+                  std::vector<std::vector<HMCResponse *>> &queues) {
+    ckpt.ExpectSize(queues.size());
+    for (auto &queue : queues) {
+        for (auto resp : queue) {
+            delete (resp);
+        }
+        queue.resize(ckpt.GetSize());
+        for (auto &resp : queue) {
+            resp = GetResponse(ckpt);
+        }
+    }
+}
+}  // namespace
+
+void HMCMemorySystem::SaveState(CheckpointWriter &ckpt) const {
+    BaseDRAMSystem::SaveState(ckpt);
+    ckpt.Put(logic_clk_);
+    ckpt.Put(logic_ps_);
+    ckpt.Put(dram_ps_);
+    ckpt.Put(next_link_);
+    // responses waiting for their vault, empty slots as a leading false
+    ckpt.Put(static_cast<uint64_t>(resp_slots_.size()));
+    for (const auto resp : resp_slots_) {
+        ckpt.Put(resp != nullptr);
+        if (resp) {
+            PutResponse(ckpt, resp);
+        }
+    }
+    ckpt.Put(free_resp_slots_);
+    PutRequests(ckpt, link_req_queues_);
+    PutResponses(ckpt, link_resp_queues_);
+    PutRequests(ckpt, quad_req_queues_);
+    PutResponses(ckpt, quad_resp_queues_);
+    ckpt.Put(link_busy_);
+    ckpt.Put(quad_busy_);
+    ckpt.Put(link_age_counter_);
+    ckpt.Put(quad_age_counter_);
+}
+
+void HMCMemorySystem::RestoreState(CheckpointReader &ckpt) {
+    BaseDRAMSystem::RestoreState(ckpt);
+    ckpt.Get(logic_clk_);
+    ckpt.Get(logic_ps_);
+    ckpt.Get(dram_ps_);
+    ckpt.Get(next_link_);
+    for (auto resp : resp_slots_) {
+        delete (resp);
+    }
+    resp_slots_.resize(ckpt.GetSize());
+    for (auto &resp : resp_slots_) {
+        bool has_resp;
+        ckpt.Get(has_resp);
+        resp = has_resp ? GetResponse(ckpt) : nullptr;
+    }
+    ckpt.Get(free_resp_slots_);
+    GetRequests(ckpt, link_req_queues_);
+    GetResponses(ckpt, link_resp_queues_);
+    GetRequests(ckpt, quad_req_queues_);
+    GetResponses(ckpt, quad_resp_queues_);
+    ckpt.Get(link_busy_);
+    ckpt.Get(quad_busy_);
+    ckpt.Get(link_age_counter_);
+    ckpt.Get(quad_age_counter_);
+    if (link_busy_.size() != static_cast<size_t>(links_) ||
+        link_age_counter_.size() != static_cast<size_t>(links_) ||
+        quad_busy_.size() != 4 || quad_age_counter_.size() != 4 ||
+        !Consistent()) {
+        ckpt.Fail();
+    }
+}
+
+size_t HMCMemorySystem::RetagInFlight(uint64_t tag) {
+    // every request has its response waiting in a slot from the start
+    size_t num_in_flight = callback_sink_.Retag(tag);
+    for (auto resp : resp_slots_) {
+        if (resp) {
+            resp->tag = tag;
+            num_in_flight++;
+        }
+    }
+    for (auto queues : {&link_req_queues_, &quad_req_queues_}) {
+        for (auto &queue : *queues) {
+            for (auto req : queue) {
+                req->tag = tag;
+            }
+        }
+    }
+    for (auto queues : {&link_resp_queues_, &quad_resp_queues_}) {
+        for (auto &queue : *queues) {
+            for (auto resp : queue) {
+                resp->tag = tag;
+            }
+            num_in_flight += queue.size();
+        }
+    }
+    return num_in_flight;
+}
+
+bool HMCMemorySystem::Consistent() const {
+    // everything the packets and free slots index has to exist, and a free
+    // slot has to be free
+    int num_slots = static_cast<int>(resp_slots_.size());
+    std::vector<bool> is_free(resp_slots_.size(), false);
+    for (int slot : free_resp_slots_) {
+        if (slot < 0 || slot >= num_slots || is_free[slot] ||
+            resp_slots_[slot] != nullptr) {
+            return false;
+        }
+        is_free[slot] = true;
+    }
+    auto request_ok = [this, num_slots](const HMCRequest *req) {
+        return req->link >= 0 && req->link < links_ && req->quad >= 0 &&
+               req->quad < 4 && req->vault >= 0 &&
+               req->vault < static_cast<int>(ctrls_.size()) &&
+               req->resp_slot >= 0 && req->resp_slot < num_slots;
+    };
+    auto response_ok = [this](const HMCResponse *resp) {
+        return resp == nullptr || (resp->link >= 0 && resp->link < links_ &&
+                                   resp->quad >= 0 && resp->quad < 4);
+    };
+    for (const auto &queues : {&link_req_queues_, &quad_req_queues_}) {
+        for (const auto &queue : *queues) {
+            if (!std::all_of(queue.begin(), queue.end(), request_ok)) {
+                return false;
+            }
+        }
+    }
+    for (const auto &queues : {&link_resp_queues_, &quad_resp_queues_}) {
+        for (const auto &queue : *queues) {
+            if (!std::all_of(queue.begin(), queue.end(), response_ok)) {
+                return false;
+            }
+        }
+    }
+    return std::all_of(resp_slots_.begin(), resp_slots_.end(), response_ok);
+}
+
 }  // namespace dramsim3
@@ -2,7 +2,6 @@
 #define __HMC_H
 
 #include <functional>
-#include <map>
 #include <vector>
 
 #include "dram_system.h"
@@ -86,6 +85,9 @@ class HMCRequest {
     int vault;
     int flits;
     bool is_write;
+    uint64_t tag;
+    // where the matching response waits for the vault, see resp_slots_
+    int resp_slot;
     // this exit_time is the time to exit xbar to vaults
     uint64_t exit_time;
 };
@@ -98,6 +100,7 @@ class HMCResponse {
     int link;
     int quad;
     int flits;
+    uint64_t tag;
     // this exit_time is the time to exit xbar to cpu
     uint64_t exit_time;
 };
@@ -115,11 +118,22 @@ class HMCMemorySystem : public BaseDRAMSystem {
 
     // had to have 3 insert interfaces cuz HMC is so different...
     bool WillAcceptTransaction(uint64_t hex_addr, bool is_write) const override;
-    bool AddTransaction(uint64_t hex_addr, bool is_write) override;
+    bool AddTransaction(uint64_t hex_addr, bool is_write,
+                        uint64_t tag) override;
     bool InsertReqToLink(HMCRequest* req, int link);
     bool InsertHMCReq(HMCRequest* req);
+    void FunctionalSkip(uint64_t clk) override;
+    // the host tags are in the packets, the vaults' tags are response slots
+    size_t RetagInFlight(uint64_t tag) override;
+
+   protected:
+    // the vaults plus every packet in the crossbar and the arbitration state
+    void SaveState(CheckpointWriter& ckpt) const override;
+    void RestoreState(CheckpointReader& ckpt) override;
 
    private:
+    // whether every restored slot, link, quad and vault index is in range
+    bool Consistent() const;
     uint64_t logic_clk_, ps_per_dram_, ps_per_logic_, logic_ps_, dram_ps_;
 
     void SetClockRatio();
@@ -127,7 +141,7 @@ class HMCMemorySystem : public BaseDRAMSystem {
     void DrainRequests();
     void DrainResponses();
     void InsertReqToDRAM(HMCRequest* req);
-    void VaultCallback(uint64_t req_id);
+    void VaultCallback(int resp_slot);
     std::vector<int> BuildAgeQueue(std::vector<int>& age_counter);
     void XbarArbitrate();
     inline void IterateNextLink();
@@ -139,9 +153,11 @@ class HMCMemorySystem : public BaseDRAMSystem {
     // number of flits xbar can process per logic cycle
     const int xbar_bandwidth_ = 2;
 
-    // had to use a multimap because the controller callback return hex addr
-    // instead of unique id
-    std::multimap<uint64_t, HMCResponse*> resp_lookup_table_;
+    // responses waiting for their vault, indexed by the slot their request
+    // carries down to the vault as the transaction tag, so requests to the
+    // same address each get their own response back
+    std::vector<HMCResponse*> resp_slots_;
+    std::vector<int> free_resp_slots_;
     // these are essentially input/output buffers for xbars
     std::vector<std::vector<HMCRequest*>> link_req_queues_;
     std::vector<std::vector<HMCResponse*>> link_resp_queues_;
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <stdexcept>
 #include "./../ext/headers/args.hxx"
 #include "cpu.h"
 
@@ -10,7 +11,14 @@ int main(int argc, const char **argv) {
         "Examples: \n."
         "./build/dramsim3main configs/DDR4_8Gb_x8_3200.ini -c 100 -t "
         "sample_trace.txt\n"
-        "./build/dramsim3main configs/DDR4_8Gb_x8_3200.ini -s random -c 100");
+        "./build/dramsim3main configs/DDR4_8Gb_x8_3200.ini -s random -c 100\n"
+        "./build/dramsim3main configs/DDR4_8Gb_x8_3200.ini -c 100 "
+        "-t core0.trace,16 -t core1.trace,16,0x100000000\n"
+        "./build/dramsim3main configs/DDR4_8Gb_x8_3200.ini -c 100000000 -t "
+        "long.trace --sample 100000,1000,2000\n"
+        "./build/dramsim3main configs/DDR4_8Gb_x8_2400.ini "
+        "configs/DDR4_8Gb_x8_3200.ini -c 100000 -t sample_trace.txt "
+        "--sweep-threads");
     args::HelpFlag help(parser, "help", "Display the help menu", {'h', "help"});
     args::ValueFlag<uint64_t> num_cycles_arg(parser, "num_cycles",
                                              "Number of cycles to simulate",
@@ -21,12 +29,38 @@ int main(int argc, const char **argv) {
     args::ValueFlag<std::string> stream_arg(
         parser, "stream_type", "address stream generator - (random), stream",
         {'s', "stream"}, "");
-    args::ValueFlag<std::string> trace_file_arg(
+    args::ValueFlagList<std::string> trace_file_arg(
         parser, "trace",
-        "Trace file, setting this option will ignore -s option",
+        "Trace file, setting this option will ignore -s option. Repeat it to "
+        "replay one trace per core as file[,max_outstanding[,addr_offset]]",
         {'t', "trace"});
-    args::Positional<std::string> config_arg(
-        parser, "config", "The config file name (mandatory)");
+    args::Flag closed_loop_arg(
+        parser, "closed_loop",
+        "Replay the trace closed loop: gaps between added cycles count from "
+        "the previous issue and DEP transactions wait for earlier reads",
+        {"closed-loop"});
+    args::ValueFlag<std::string> sample_arg(
+        parser, "sampling",
+        "Sample a single trace as interval,window[,warmup] in transactions: "
+        "the last window of every interval is measured after warmup more in "
+        "detail, the rest is only fast-forwarded. Warmup defaults to window",
+        {"sample"});
+    args::ValueFlag<std::string> restore_arg(
+        parser, "checkpoint",
+        "Start from the memory system state saved in this checkpoint",
+        {"restore"});
+    args::ValueFlag<std::string> save_arg(
+        parser, "checkpoint",
+        "Save the memory system state to this checkpoint at the end",
+        {"save"});
+    args::Flag sweep_threads_arg(
+        parser, "sweep_threads",
+        "With several configs simulate each of them on a thread of its own",
+        {"sweep-threads"});
+    args::PositionalList<std::string> config_arg(
+        parser, "config",
+        "The config file name (mandatory). Several configs replay one trace "
+        "into each of them, with the stats in a subdirectory per config");
 
     try {
         parser.ParseCLI(argc, argv);
@@ -39,20 +73,72 @@ int main(int argc, const char **argv) {
         return 1;
     }
 
-    std::string config_file = args::get(config_arg);
-    if (config_file.empty()) {
+    std::vector<std::string> config_files = args::get(config_arg);
+    if (config_files.empty() || config_files[0].empty()) {
         std::cerr << parser;
         return 1;
     }
+    std::string config_file = config_files[0];
 
     uint64_t cycles = args::get(num_cycles_arg);
     std::string output_dir = args::get(output_dir_arg);
-    std::string trace_file = args::get(trace_file_arg);
+    std::vector<std::string> trace_files = args::get(trace_file_arg);
     std::string stream_type = args::get(stream_arg);
+    bool closed_loop = args::get(closed_loop_arg);
+    bool single_trace = trace_files.size() == 1 &&
+                        trace_files[0].find(',') == std::string::npos;
+
+    std::unique_ptr<Sampler> sampler;
+    if (sample_arg) {
+        std::string spec = args::get(sample_arg);
+        auto fields = StringSplit(spec, ',');
+        if (fields.size() < 2 || fields.size() > 3) {
+            std::cerr << "Bad sampling spec " << spec
+                      << ", expecting interval,window[,warmup]" << std::endl;
+            return 1;
+        }
+        if (!single_trace) {
+            std::cerr << "Sampling takes a single trace" << std::endl;
+            return 1;
+        }
+        try {
+            uint64_t interval = std::stoull(fields[0]);
+            uint64_t window = std::stoull(fields[1]);
+            uint64_t warmup =
+                fields.size() > 2 ? std::stoull(fields[2]) : window;
+            sampler.reset(new Sampler(interval, window, warmup));
+        } catch (const std::logic_error &) {
+            std::cerr << "Bad number in sampling spec " << spec << std::endl;
+            return 1;
+        }
+    }
+
+    if (config_files.size() > 1) {
+        if (!single_trace) {
+            std::cerr << "Several configs take a single trace" << std::endl;
+            return 1;
+        }
+        if (restore_arg || save_arg) {
+            std::cerr << "Several configs cannot be checkpointed" << std::endl;
+            return 1;
+        }
+        SweepCPU sweep(config_files, output_dir, trace_files[0], closed_loop,
+                       sampler.get(), args::get(sweep_threads_arg));
+        sweep.Run(cycles);
+        sweep.PrintStats();
+        return 0;
+    }
 
     CPU *cpu;
-    if (!trace_file.empty()) {
-        cpu = new TraceBasedCPU(config_file, output_dir, trace_file);
+    if (single_trace) {
+        cpu = new TraceBasedCPU(config_file, output_dir, trace_files[0],
+                                closed_loop, std::move(sampler));
+    } else if (!trace_files.empty()) {
+        if (closed_loop) {
+            std::cerr << "Closed loop replay takes a single trace" << std::endl;
+            return 1;
+        }
+        cpu = new MultiTraceCPU(config_file, output_dir, trace_files);
     } else {
         if (stream_type == "stream" || stream_type == "s") {
             cpu = new StreamCPU(config_file, output_dir);
@@ -61,9 +147,16 @@ int main(int argc, const char **argv) {
         }
     }
 
-    for (uint64_t clk = 0; clk < cycles; clk++) {
+    if (restore_arg && !cpu->RestoreCheckpoint(args::get(restore_arg))) {
+        return 1;
+    }
+    // a sampled replay skips cycles and stops with its trace
+    while (cpu->GetClk() < cycles && !cpu->Finished()) {
         cpu->ClockTick();
     }
+    if (save_arg && !cpu->SaveCheckpoint(args::get(save_arg))) {
+        return 1;
+    }
     cpu->PrintStats();
 
     delete cpu;
@@ -0,0 +1,31 @@
+#ifndef __MEMORY_REQUEST_H
+#define __MEMORY_REQUEST_H
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+
+namespace dramsim3 {
+
+// A transaction as the host sees it in the batched MemorySystem interface,
+// both going in (AddTransactions) and coming back out (DrainCompletions).
+// tag is not interpreted, it is handed back with the completion.
+struct MemoryRequest {
+    uint64_t addr;
+    bool is_write;
+    uint64_t tag;
+};
+
+// completion callback that also gets the tag the transaction was added with
+typedef std::function<void(uint64_t addr, uint64_t tag)> TaggedCallback;
+
+// a stat worked out by the host, to go into the stats outputs with the
+// memory system's own
+struct HostStat {
+    std::string name;
+    double value;
+    std::string description;
+};
+
+}  // namespace dramsim3
+#endif
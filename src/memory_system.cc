@@ -1,4 +1,5 @@
 #include "memory_system.h"
+#include "profiler.h"
 
 namespace dramsim3 {
 MemorySystem::MemorySystem(const std::string &config_file,
@@ -21,7 +22,15 @@ MemorySystem::~MemorySystem() {
     delete (config_);
 }
 
-void MemorySystem::ClockTick() { dram_system_->ClockTick(); }
+void MemorySystem::ClockTick() {
+    PROFILE_SCOPE(TICK);
+    dram_system_->ClockTick();
+}
+
+uint64_t MemorySystem::ClockTickUntil(uint64_t clk) {
+    PROFILE_SCOPE(TICK);
+    return dram_system_->ClockTickUntil(clk);
+}
 
 double MemorySystem::GetTCK() const { return config_->tCK; }
 
@@ -37,19 +46,68 @@ void MemorySystem::RegisterCallbacks(
     dram_system_->RegisterCallbacks(read_callback, write_callback);
 }
 
+void MemorySystem::RegisterTaggedCallbacks(TaggedCallback read_callback,
+                                           TaggedCallback write_callback) {
+    dram_system_->RegisterTaggedCallbacks(read_callback, write_callback);
+}
+
+void MemorySystem::RegisterCompletionSink(CompletionSink *sink) {
+    dram_system_->RegisterCompletionSink(sink);
+}
+
 bool MemorySystem::WillAcceptTransaction(uint64_t hex_addr,
                                          bool is_write) const {
     return dram_system_->WillAcceptTransaction(hex_addr, is_write);
 }
 
 bool MemorySystem::AddTransaction(uint64_t hex_addr, bool is_write) {
-    return dram_system_->AddTransaction(hex_addr, is_write);
+    return dram_system_->AddTransaction(hex_addr, is_write, 0);
+}
+
+bool MemorySystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                  uint64_t tag) {
+    return dram_system_->AddTransaction(hex_addr, is_write, tag);
+}
+
+size_t MemorySystem::AddTransactions(const MemoryRequest *requests,
+                                     size_t count) {
+    return dram_system_->AddTransactions(requests, count);
+}
+
+size_t MemorySystem::DrainCompletions(MemoryRequest *completions,
+                                      size_t capacity) {
+    return dram_system_->DrainCompletions(completions, capacity);
 }
 
 void MemorySystem::PrintStats() const { dram_system_->PrintStats(); }
 
 void MemorySystem::ResetStats() { dram_system_->ResetStats(); }
 
+bool MemorySystem::SaveCheckpoint(const std::string &file) {
+    return dram_system_->SaveCheckpoint(file);
+}
+
+bool MemorySystem::RestoreCheckpoint(const std::string &file) {
+    return dram_system_->RestoreCheckpoint(file);
+}
+
+size_t MemorySystem::RetagInFlight(uint64_t tag) {
+    return dram_system_->RetagInFlight(tag);
+}
+
+void MemorySystem::FunctionalSkip(uint64_t clk) {
+    dram_system_->FunctionalSkip(clk);
+}
+
+void MemorySystem::FunctionalAccess(uint64_t hex_addr, bool is_write) {
+    dram_system_->FunctionalAccess(hex_addr, is_write);
+}
+
+void MemorySystem::AppendStats(const std::string &section,
+                               const std::vector<HostStat> &stats) {
+    dram_system_->AppendStats(section, stats);
+}
+
 MemorySystem* GetMemorySystem(const std::string &config_file, const std::string &output_dir,
                  std::function<void(uint64_t)> read_callback,
                  std::function<void(uint64_t)> write_callback) {
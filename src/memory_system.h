@@ -3,10 +3,13 @@
 
 #include <functional>
 #include <string>
+#include <vector>
 
+#include "completion_sink.h"
 #include "configuration.h"
 #include "dram_system.h"
 #include "hmc.h"
+#include "memory_request.h"
 
 namespace dramsim3 {
 
@@ -18,6 +21,11 @@ class MemorySystem {
                  std::function<void(uint64_t)> write_callback);
     ~MemorySystem();
     void ClockTick();
+    // Tick up to cycle clk, stopping early after the first cycle that
+    // completes a transaction, returns the cycle reached. Cycles in which
+    // nothing can happen are skipped instead of ticked one by one, so a host
+    // with nothing to issue should call this rather than ClockTick().
+    uint64_t ClockTickUntil(uint64_t clk);
     void RegisterCallbacks(std::function<void(uint64_t)> read_callback,
                            std::function<void(uint64_t)> write_callback);
     double GetTCK() const;
@@ -30,6 +38,54 @@ class MemorySystem {
     bool WillAcceptTransaction(uint64_t hex_addr, bool is_write) const;
     bool AddTransaction(uint64_t hex_addr, bool is_write);
 
+    // Tagged interface: tag is handed back verbatim on completion, so
+    // transactions to the same address can be told apart. Once registered the
+    // tagged callbacks are used instead of the plain ones, an empty one
+    // falls back to them.
+    void RegisterTaggedCallbacks(TaggedCallback read_callback,
+                                 TaggedCallback write_callback);
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t tag);
+
+    // Batched interface, one call per batch instead of per transaction.
+    // Add requests in order up to the first one that is not accepted this
+    // cycle, returns how many were added.
+    size_t AddTransactions(const MemoryRequest *requests, size_t count);
+    // Completions of reads (writes) only reach the read (write) callback if
+    // it is set, passing an empty std::function instead buffers them along
+    // with their tags. Move up to capacity of them into completions, oldest
+    // first, returns how many were moved.
+    size_t DrainCompletions(MemoryRequest *completions, size_t capacity);
+
+    // Hand each cycle's completions to sink in one call instead of going
+    // through the callbacks, until callbacks are registered again. nullptr
+    // goes back to the callbacks. sink must outlive its registration.
+    void RegisterCompletionSink(CompletionSink *sink);
+
+    // Save the whole state of the memory system to file, or restore one so
+    // a warmup can be paid once and shared by many runs. The restoring
+    // system may use a different config as long as protocol, channels,
+    // ranks and banks match and its queues hold what was queued. Callbacks
+    // and sinks are not part of the snapshot. Both return false and say
+    // why on stderr if they fail, a failed restore leaves the memory system
+    // unusable.
+    bool SaveCheckpoint(const std::string &file);
+    bool RestoreCheckpoint(const std::string &file);
+    // Give every transaction still in flight the tag tag. A host restoring
+    // a snapshot it did not take calls this after RestoreCheckpoint, so it
+    // can tell the completions of the restored transactions from its own.
+    // Returns how many of those completions are still to come.
+    size_t RetagInFlight(uint64_t tag);
+
+    // Functional fast-forward for sampled simulation, only while nothing is
+    // in flight: FunctionalSkip jumps to cycle clk with only the refreshes
+    // due on the way applied to the banks, FunctionalAccess opens and closes
+    // rows as a transaction would, in no time. Neither counts in the stats.
+    void FunctionalSkip(uint64_t clk);
+    void FunctionalAccess(uint64_t hex_addr, bool is_write);
+    // add a section of host worked out stats to the outputs of PrintStats
+    void AppendStats(const std::string &section,
+                     const std::vector<HostStat> &stats);
+
    private:
     // These have to be pointers because Gem5 will try to push this object
     // into container which will invoke a copy constructor, using pointers
@@ -0,0 +1,114 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace dramsim3 {
+
+namespace {
+const char* const kPhaseNames[] = {"tick",
+                                   "get_command_to_issue",
+                                   "update_timing",
+                                   "schedule_transaction",
+                                   "stats",
+                                   "callbacks"};
+const char* const kPhaseDescs[] = {
+    "Memory system ClockTick",
+    "CommandQueue::GetCommandToIssue",
+    "ChannelState::UpdateTiming",
+    "Controller::ScheduleTransaction",
+    "Command and epoch stats",
+    "Completion callbacks"};
+
+using Clock = std::chrono::steady_clock;
+
+struct ProfileTotals {
+    uint64_t calls[kNumProfilePhases] = {};
+    uint64_t ticks[kNumProfilePhases] = {};
+
+    void Add(const ProfileCounters& counters) {
+        for (int i = 0; i < kNumProfilePhases; i++) {
+            calls[i] += counters.calls[i].load(std::memory_order_relaxed);
+            ticks[i] += counters.ticks[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+// the counters of all threads, the ones of finished threads are added up
+struct ProfileRegistry {
+    ProfileRegistry() : start_ticks(ProfileTicks()), start_time(Clock::now()) {}
+
+    std::mutex mutex;
+    std::vector<const ProfileCounters*> live;
+    ProfileTotals finished;
+    uint64_t start_ticks;
+    Clock::time_point start_time;
+};
+
+ProfileRegistry& Registry() {
+    static ProfileRegistry registry;
+    return registry;
+}
+
+struct ThreadCounters {
+    ThreadCounters() {
+        auto& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(&counters);
+    }
+    ~ThreadCounters() {
+        auto& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.finished.Add(counters);
+        registry.live.erase(
+            std::find(registry.live.begin(), registry.live.end(), &counters));
+    }
+
+    ProfileCounters counters;
+};
+}  // namespace
+
+ProfileCounters& ThreadProfileCounters() {
+    thread_local ThreadCounters thread_counters;
+    return thread_counters.counters;
+}
+
+std::vector<HostStat> ProfileStats() {
+    auto& registry = Registry();
+    ProfileTotals total;
+    uint64_t ticks;
+    double seconds;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        // threads that are still counting are read as far as they got
+        total = registry.finished;
+        for (const auto counters : registry.live) {
+            total.Add(*counters);
+        }
+        ticks = ProfileTicks() - registry.start_ticks;
+        seconds = std::chrono::duration<double>(Clock::now() -
+                                                registry.start_time)
+                      .count();
+    }
+    double seconds_per_tick = ticks > 0 ? seconds / ticks : 0.0;
+
+    std::vector<HostStat> stats;
+    stats.push_back(
+        {"wall_seconds", seconds, "Wall time since profiling began"});
+    for (int i = 0; i < kNumProfilePhases; i++) {
+        std::string name = kPhaseNames[i];
+        double phase_seconds = total.ticks[i] * seconds_per_tick;
+        stats.push_back({name + "_calls", static_cast<double>(total.calls[i]),
+                         std::string("Calls of ") + kPhaseDescs[i]});
+        stats.push_back({name + "_seconds", phase_seconds,
+                         std::string("Seconds in ") + kPhaseDescs[i]});
+        stats.push_back({name + "_share",
+                         seconds > 0 ? phase_seconds / seconds : 0.0,
+                         "Share of wall time (summed over threads)"});
+    }
+    return stats;
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,88 @@
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "memory_request.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace dramsim3 {
+
+// Where the simulator spends its time. TICK is everything under the memory
+// system's ClockTick, the other phases are parts of it.
+enum class ProfilePhase {
+    TICK,
+    GET_COMMAND,
+    UPDATE_TIMING,
+    SCHEDULE_TRANSACTION,
+    STATS,
+    CALLBACKS,
+    SIZE
+};
+
+const int kNumProfilePhases = static_cast<int>(ProfilePhase::SIZE);
+
+// calls and timestamp counter ticks per phase, only added to by the thread
+// they belong to but read from others, hence relaxed atomics
+struct ProfileCounters {
+    std::atomic<uint64_t> calls[kNumProfilePhases] = {};
+    std::atomic<uint64_t> ticks[kNumProfilePhases] = {};
+
+    void Add(int phase, uint64_t elapsed) {
+        // a single writer needs no read-modify-write
+        calls[phase].store(calls[phase].load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+        ticks[phase].store(
+            ticks[phase].load(std::memory_order_relaxed) + elapsed,
+            std::memory_order_relaxed);
+    }
+};
+
+inline uint64_t ProfileTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// the calling thread's counters, every thread counts on its own
+ProfileCounters& ThreadProfileCounters();
+
+// calls, seconds and share of the wall time for every phase, summed over
+// all threads, the wall time counting from the first timed scope or call of
+// this in the process, whichever came first
+std::vector<HostStat> ProfileStats();
+
+// Counts a call of a phase and the time until it goes out of scope
+class ProfileTimer {
+   public:
+    explicit ProfileTimer(ProfilePhase phase)
+        : counters_(ThreadProfileCounters()),
+          phase_(static_cast<int>(phase)),
+          start_(ProfileTicks()) {}
+    ~ProfileTimer() { counters_.Add(phase_, ProfileTicks() - start_); }
+
+   private:
+    ProfileCounters& counters_;
+    int phase_;
+    uint64_t start_;
+};
+
+// Hot path instrumentation, compiled in with -DPROFILE (cmake -DPROFILE=1)
+// and reported as the "profile" section of the stats
+#ifdef PROFILE
+#define PROFILE_SCOPE(phase) ProfileTimer profile_timer_(ProfilePhase::phase)
+#else
+#define PROFILE_SCOPE(phase)
+#endif  // PROFILE
+
+}  // namespace dramsim3
+#endif
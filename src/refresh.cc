@@ -26,6 +26,28 @@ void Refresh::ClockTick() {
     return;
 }
 
+void Refresh::FunctionalSkip(uint64_t cycles) {
+    uint64_t end = clk_ + cycles;
+    while (true) {
+        while (channel_state_.IsRefreshWaiting()) {
+            channel_state_.FunctionalUpdate(channel_state_.PendingRefCommand());
+        }
+        uint64_t refresh_cycle = NextRefreshCycle();
+        if (refresh_cycle >= end) {
+            break;
+        }
+        InsertRefresh();
+        clk_ = refresh_cycle + 1;
+    }
+    clk_ = end;
+}
+
+uint64_t Refresh::NextRefreshCycle() const {
+    uint64_t interval = static_cast<uint64_t>(refresh_interval_);
+    uint64_t next_cycle = (clk_ + interval - 1) / interval * interval;
+    return next_cycle == 0 ? interval : next_cycle;
+}
+
 void Refresh::InsertRefresh() {
     switch (refresh_policy_) {
         // Simultaneous all rank refresh
@@ -81,4 +103,18 @@ void Refresh::IterateNext() {
     }
 }
 
+void Refresh::SaveState(CheckpointWriter &ckpt) const {
+    ckpt.Put(clk_);
+    ckpt.Put(next_rank_);
+    ckpt.Put(next_bg_);
+    ckpt.Put(next_bank_);
+}
+
+void Refresh::RestoreState(CheckpointReader &ckpt) {
+    ckpt.Get(clk_);
+    ckpt.Get(next_rank_);
+    ckpt.Get(next_bg_);
+    ckpt.Get(next_bank_);
+}
+
 }  // namespace dramsim3
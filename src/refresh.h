@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "channel_state.h"
+#include "checkpoint.h"
 #include "common.h"
 #include "configuration.h"
 
@@ -12,6 +13,13 @@ class Refresh {
    public:
     Refresh(const Config& config, ChannelState& channel_state);
     void ClockTick();
+    void SkipCycles(uint64_t cycles) { clk_ += cycles; }
+    // functional fast-forward, refreshes that come due in the next cycles
+    // (or are still waiting) are applied to the bank states right away
+    void FunctionalSkip(uint64_t cycles);
+    uint64_t NextRefreshCycle() const;
+    void SaveState(CheckpointWriter& ckpt) const;
+    void RestoreState(CheckpointReader& ckpt);
 
    private:
     uint64_t clk_;
@@ -0,0 +1,138 @@
+#include "sampling.h"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include "common.h"
+
+namespace dramsim3 {
+
+namespace {
+// two sided 95% critical values of Student's t for 1 to 30 degrees of
+// freedom, the normal distribution's beyond that
+const double kT95[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365,
+                       2.306,  2.262, 2.228, 2.201, 2.179, 2.160, 2.145,
+                       2.131,  2.120, 2.110, 2.101, 2.093, 2.086, 2.080,
+                       2.074,  2.069, 2.064, 2.060, 2.056, 2.052, 2.048,
+                       2.045,  2.042};
+const size_t kNumT95 = sizeof(kT95) / sizeof(kT95[0]);
+const double kZ95 = 1.960;
+
+// the ratio estimate sum(num) / sum(den) over the samples and the half
+// width of its 95% confidence interval by the delta method, which is NaN
+// for fewer than 2 samples
+void RatioAndInterval(const std::vector<double>& num,
+                      const std::vector<double>& den, double& ratio,
+                      double& interval) {
+    ratio = std::numeric_limits<double>::quiet_NaN();
+    interval = std::numeric_limits<double>::quiet_NaN();
+    size_t n = num.size();
+    if (n == 0) {
+        return;
+    }
+    double num_sum = 0.0;
+    double den_sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        num_sum += num[i];
+        den_sum += den[i];
+    }
+    ratio = num_sum / den_sum;
+    if (n < 2) {
+        return;
+    }
+    // spread of the samples around the ratio, relative to the mean den
+    double sq_sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double residual = num[i] - ratio * den[i];
+        sq_sum += residual * residual;
+    }
+    double std_dev = std::sqrt(sq_sum / (n - 1));
+    double den_mean = den_sum / n;
+    double t = n - 1 <= kNumT95 ? kT95[n - 2] : kZ95;
+    interval = t * std_dev / (std::sqrt(static_cast<double>(n)) * den_mean);
+}
+}  // namespace
+
+Sampler::Sampler(uint64_t interval, uint64_t window, uint64_t warmup)
+    : interval_(interval),
+      window_(window),
+      warmup_(warmup),
+      window_open_(false),
+      first_issue_clk_(0),
+      last_done_clk_(0),
+      num_done_(0),
+      num_reads_(0),
+      read_latency_sum_(0) {
+    // without a functional part in every interval windows would run into
+    // each other and nothing is skipped anyway
+    if (window_ == 0 || interval_ <= window_ + warmup_) {
+        std::cerr << "Sampling needs interval > window + warmup > 0, got "
+                  << interval_ << ", " << window_ << ", " << warmup_
+                  << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+}
+
+void Sampler::Issued(uint64_t clk) {
+    if (!window_open_) {
+        window_open_ = true;
+        first_issue_clk_ = clk;
+        last_done_clk_ = clk;
+        num_done_ = 0;
+        num_reads_ = 0;
+        read_latency_sum_ = 0;
+    }
+}
+
+void Sampler::Completed(bool is_write, uint64_t latency, uint64_t clk) {
+    num_done_++;
+    last_done_clk_ = clk;
+    if (!is_write) {
+        num_reads_++;
+        read_latency_sum_ += latency;
+    }
+}
+
+void Sampler::CloseWindow() {
+    if (!window_open_) {
+        return;
+    }
+    window_open_ = false;
+    if (num_done_ == 0) {
+        return;
+    }
+    window_done_.push_back(num_done_);
+    window_cycles_.push_back(last_done_clk_ - first_issue_clk_ + 1);
+    if (num_reads_ > 0) {
+        window_latency_sums_.push_back(read_latency_sum_);
+        window_reads_.push_back(num_reads_);
+    }
+}
+
+std::vector<HostStat> Sampler::Stats(uint64_t bytes_per_trans,
+                                     double tck) const {
+    double latency, latency_interval, bandwidth, bandwidth_interval;
+    RatioAndInterval(window_latency_sums_, window_reads_, latency,
+                     latency_interval);
+    RatioAndInterval(window_done_, window_cycles_, bandwidth,
+                     bandwidth_interval);
+    // transactions per cycle to GB/s
+    double scale = bytes_per_trans / tck;
+    double detailed = static_cast<double>(window_ + warmup_) / interval_;
+    return {
+        {"sampled_windows", static_cast<double>(NumSamples()),
+         "Number of measured windows"},
+        {"detailed_fraction", detailed,
+         "Fraction of transactions simulated in detail"},
+        {"sampled_read_latency", latency,
+         "Read latency over all reads of the windows (cycles)"},
+        {"sampled_read_latency_ci95", latency_interval,
+         "Half width of its 95% confidence interval (cycles)"},
+        {"sampled_bandwidth", bandwidth * scale,
+         "Bandwidth over all cycles of the windows (GB/s)"},
+        {"sampled_bandwidth_ci95", bandwidth_interval * scale,
+         "Half width of its 95% confidence interval (GB/s)"}};
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,68 @@
+#ifndef __SAMPLING_H
+#define __SAMPLING_H
+
+#include <cstdint>
+#include <vector>
+#include "memory_request.h"
+
+namespace dramsim3 {
+
+// Systematic (SMARTS style) sampling of a transaction stream. Out of every
+// interval transactions the last warmup + window are simulated in detail and
+// the last window of those are measured, the others are only fast-forwarded
+// functionally. Every measured window is one sample of read latency and
+// bandwidth. Windows differ in length and number of reads, so both are
+// ratio estimates over all windows (total latency over total reads, total
+// completions over total cycles) and the spread of the windows around them
+// bounds their error.
+class Sampler {
+   public:
+    enum class Phase { FUNCTIONAL, WARMUP, MEASURE };
+
+    Sampler(uint64_t interval, uint64_t window, uint64_t warmup);
+
+    // phase of the index-th transaction of the stream
+    Phase PhaseOf(uint64_t index) const {
+        uint64_t pos = index % interval_;
+        if (pos < interval_ - window_ - warmup_) {
+            return Phase::FUNCTIONAL;
+        }
+        return pos < interval_ - window_ ? Phase::WARMUP : Phase::MEASURE;
+    }
+
+    // a measured transaction was issued / completed at clk
+    void Issued(uint64_t clk);
+    void Completed(bool is_write, uint64_t latency, uint64_t clk);
+    // the current window is over, it is a sample if anything completed
+    void CloseWindow();
+
+    size_t NumSamples() const { return window_cycles_.size(); }
+
+    // read latency and bandwidth with the half widths of their 95%
+    // confidence intervals, bandwidth in GB/s given the size of a
+    // transaction and tCK
+    std::vector<HostStat> Stats(uint64_t bytes_per_trans, double tck) const;
+
+   private:
+    uint64_t interval_;
+    uint64_t window_;
+    uint64_t warmup_;
+
+    // the window being measured
+    bool window_open_;
+    uint64_t first_issue_clk_;
+    uint64_t last_done_clk_;
+    uint64_t num_done_;
+    uint64_t num_reads_;
+    uint64_t read_latency_sum_;
+
+    // one per window, completions over cycles for the bandwidth and, of the
+    // windows with reads, summed latency over reads for the latency
+    std::vector<double> window_done_;
+    std::vector<double> window_cycles_;
+    std::vector<double> window_latency_sums_;
+    std::vector<double> window_reads_;
+};
+
+}  // namespace dramsim3
+#endif
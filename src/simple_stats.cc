@@ -1,10 +1,25 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <limits>
 
 #include "fmt/format.h"
 #include "simple_stats.h"
 
 namespace dramsim3 {
 
+namespace {
+// percentiles reported for every histogram stat
+const double kPercentiles[] = {0.5, 0.9, 0.99, 0.999};
+const char* const kPercentileNames[] = {"p50", "p90", "p99", "p999"};
+const char* const kPercentileDescs[] = {"50th", "90th", "99th", "99.9th"};
+const int kNumPercentiles = 4;
+
+// histograms bin values exactly up to at least this and keep the relative
+// error of larger (tail) values under 2^-kHistoPrecision
+const int kHistoPrecision = 7;
+}  // namespace
+
 template <class T>
 void PrintStatText(std::ostream& where, std::string name, T value,
                    std::string description) {
@@ -77,22 +92,14 @@ SimpleStats::SimpleStats(const Config& config, int channel_id)
              "Average request interarrival latency (cycles)");
 }
 
-void SimpleStats::AddValue(const std::string name, const int value) {
-    auto& epoch_counts = epoch_histo_counts_[name];
-    if (epoch_counts.count(value) <= 0) {
-        epoch_counts[value] = 1;
-    } else {
-        epoch_counts[value] += 1;
-    }
-}
-
 std::string SimpleStats::GetTextHeader(bool is_final) const {
     std::string header =
         "###########################################\n## Statistics of "
         "Channel " +
         std::to_string(channel_id_);
     if (!is_final) {
-        header += " of epoch " + std::to_string(counters_.at("epoch_num"));
+        header += " of epoch " +
+                  std::to_string(counters_[counter_idx_.at("epoch_num")]);
     }
     header += "\n###########################################\n";
     return header;
@@ -104,11 +111,24 @@ double SimpleStats::RankBackgroundEnergy(const int rank) const{
            vec_doubles_.at("sref_energy")[rank];
 }
 
-void SimpleStats::PrintEpochStats() {
+void SimpleStats::PrintEpochStats(StatsWriter& json_out,
+                                  ColumnWriter& column_out) {
     UpdateEpochStats();
-    if (config_.output_level >= 1) {
-        std::ofstream j_out(config_.json_epoch_name, std::ofstream::app);
-        j_out << j_data_;
+    bool json = config_.output_level >= 1 && config_.epoch_json;
+    if (json || config_.output_level >= 2) {
+        UpdatePrints(true);
+    }
+    if (json) {
+        json_out.WriteLine(j_data_.dump());
+    }
+    if (config_.output_level >= 1 && config_.epoch_columnar) {
+        if (epoch_columns_.empty()) {
+            InitEpochColumns();
+        }
+        if (!column_out.HasSchema()) {
+            column_out.SetSchema(epoch_columns_);
+        }
+        column_out.AddRow(EpochRow());
     }
     if (config_.output_level >= 2) {
         std::cout << GetTextHeader(false);
@@ -118,6 +138,102 @@ void SimpleStats::PrintEpochStats() {
         }
     }
     print_pairs_.clear();
+    ClearEpochStats();
+}
+
+void SimpleStats::InitEpochColumns() {
+    // the same stats as the epoch JSON, vectors and histograms flattened
+    // into one column per element under their names in the text output
+    std::vector<std::pair<Column, ColumnSource>> columns;
+    auto add = [&columns](const std::string& name, ColumnType type,
+                          ColumnSource::Kind kind, int idx, int pos,
+                          const double* value) {
+        columns.push_back({{name, type}, {kind, idx, pos, value}});
+    };
+    add("channel", ColumnType::INT64, ColumnSource::CHANNEL, 0, 0, nullptr);
+    for (const auto& it : counter_idx_) {
+        // like in the JSON, the epoch number is the overall count
+        auto kind = it.first == "epoch_num" ? ColumnSource::EPOCH_NUM
+                                            : ColumnSource::COUNTER;
+        add(it.first, ColumnType::UINT64, kind, it.second, 0, nullptr);
+    }
+    for (const auto& it : vec_counter_idx_) {
+        for (size_t i = 0; i < vec_counters_[it.second].size(); i++) {
+            add(it.first + "." + std::to_string(i), ColumnType::UINT64,
+                ColumnSource::VEC_COUNTER, it.second, i, nullptr);
+        }
+    }
+    for (const auto& it : histo_idx_) {
+        const auto& names = histo_headers_[it.second];
+        for (size_t i = 0; i < names.size(); i++) {
+            add(names[i], ColumnType::UINT64, ColumnSource::HISTO_BIN,
+                it.second, i, nullptr);
+        }
+        for (int i = 0; i < kNumPercentiles; i++) {
+            add(it.first + "_" + kPercentileNames[i], ColumnType::INT64,
+                ColumnSource::PERCENTILE, it.second, i, nullptr);
+        }
+    }
+    // the values of these maps stay where they are
+    for (const auto& it : doubles_) {
+        add(it.first, ColumnType::DOUBLE, ColumnSource::DOUBLE, 0, 0,
+            &it.second);
+    }
+    for (const auto& it : vec_doubles_) {
+        for (size_t i = 0; i < it.second.size(); i++) {
+            add(it.first + "." + std::to_string(i), ColumnType::DOUBLE,
+                ColumnSource::DOUBLE, 0, 0, &it.second[i]);
+        }
+    }
+    for (const auto& it : calculated_) {
+        add(it.first, ColumnType::DOUBLE, ColumnSource::DOUBLE, 0, 0,
+            &it.second);
+    }
+
+    // hash map order differs between builds, names do not
+    std::sort(columns.begin(), columns.end(),
+              [](const std::pair<Column, ColumnSource>& a,
+                 const std::pair<Column, ColumnSource>& b) {
+                  return a.first.name < b.first.name;
+              });
+    for (const auto& column : columns) {
+        epoch_columns_.push_back(column.first);
+        column_sources_.push_back(column.second);
+    }
+}
+
+const std::vector<uint64_t>& SimpleStats::EpochRow() {
+    epoch_row_.resize(column_sources_.size());
+    for (size_t i = 0; i < column_sources_.size(); i++) {
+        const auto& source = column_sources_[i];
+        uint64_t& value = epoch_row_[i];
+        switch (source.kind) {
+            case ColumnSource::CHANNEL:
+                value = static_cast<uint64_t>(channel_id_);
+                break;
+            case ColumnSource::COUNTER:
+                value = epoch_counters_[source.idx];
+                break;
+            case ColumnSource::EPOCH_NUM:
+                value = counters_[source.idx];
+                break;
+            case ColumnSource::VEC_COUNTER:
+                value = epoch_vec_counters_[source.idx][source.pos];
+                break;
+            case ColumnSource::HISTO_BIN:
+                value = epoch_histo_bins_[source.idx][source.pos];
+                break;
+            case ColumnSource::PERCENTILE:
+                value = static_cast<uint64_t>(static_cast<int64_t>(
+                    epoch_histos_[source.idx].Percentile(
+                        kPercentiles[source.pos])));
+                break;
+            case ColumnSource::DOUBLE:
+                std::memcpy(&value, source.value, sizeof(value));
+                break;
+        }
+    }
+    return epoch_row_;
 }
 
 void SimpleStats::PrintFinalStats() {
@@ -144,17 +260,13 @@ void SimpleStats::PrintFinalStats() {
 }
 
 void SimpleStats::Reset() {
-    for (auto& it : counters_) {
-        it.second = 0;
-    }
-    for (auto& it : epoch_counters_) {
-        it.second = 0;
-    }
+    std::fill(counters_.begin(), counters_.end(), 0);
+    std::fill(epoch_counters_.begin(), epoch_counters_.end(), 0);
     for (auto& vec : vec_counters_) {
-        std::fill(vec.second.begin(), vec.second.end(), 0);
+        std::fill(vec.begin(), vec.end(), 0);
     }
     for (auto& vec : epoch_vec_counters_) {
-        std::fill(vec.second.begin(), vec.second.end(), 0);
+        std::fill(vec.begin(), vec.end(), 0);
     }
     for (auto& it : doubles_) {
         it.second = 0.0;
@@ -165,30 +277,34 @@ void SimpleStats::Reset() {
     for (auto& it : calculated_) {
         it.second = 0.0;
     }
-    for (auto& it : histo_counts_) {
-        it.second.clear();
+    for (auto& histo : histos_) {
+        histo.Clear();
     }
-    for (auto& it : epoch_histo_counts_) {
-        it.second.clear();
+    for (auto& histo : epoch_histos_) {
+        histo.Clear();
     }
 }
 
-void SimpleStats::InitStat(std::string name, std::string stat_type,
-                           std::string description) {
+StatHandle SimpleStats::InitStat(std::string name, std::string stat_type,
+                                 std::string description) {
     header_descs_.emplace(name, description);
     if (stat_type == "counter") {
-        counters_.emplace(name, 0);
-        epoch_counters_.emplace(name, 0);
+        int idx = static_cast<int>(counters_.size());
+        counter_idx_.emplace(name, idx);
+        counters_.push_back(0);
+        epoch_counters_.push_back(0);
+        return StatHandle(idx);
     } else if (stat_type == "double") {
         doubles_.emplace(name, 0.0);
     } else if (stat_type == "calculated") {
         calculated_.emplace(name, 0.0);
     }
+    return StatHandle();
 }
 
-void SimpleStats::InitVecStat(std::string name, std::string stat_type,
-                              std::string description, std::string part_name,
-                              int vec_len) {
+VecStatHandle SimpleStats::InitVecStat(std::string name, std::string stat_type,
+                                       std::string description,
+                                       std::string part_name, int vec_len) {
     for (int i = 0; i < vec_len; i++) {
         std::string trailing = "." + std::to_string(i);
         std::string actual_name = name + trailing;
@@ -196,20 +312,36 @@ void SimpleStats::InitVecStat(std::string name, std::string stat_type,
         header_descs_.emplace(actual_name, actual_desc);
     }
     if (stat_type == "vec_counter") {
-        vec_counters_.emplace(name, std::vector<uint64_t>(vec_len, 0));
-        epoch_vec_counters_.emplace(name, std::vector<uint64_t>(vec_len, 0));
+        int idx = static_cast<int>(vec_counters_.size());
+        vec_counter_idx_.emplace(name, idx);
+        vec_counters_.emplace_back(vec_len, 0);
+        epoch_vec_counters_.emplace_back(vec_len, 0);
+        return VecStatHandle(idx);
     } else if (stat_type == "vec_double") {
         vec_doubles_.emplace(name, std::vector<double>(vec_len, 0));
     }
+    return VecStatHandle();
 }
 
-void SimpleStats::InitHistoStat(std::string name, std::string description,
-                                int start_val, int end_val, int num_bins) {
+HistoStatHandle SimpleStats::InitHistoStat(std::string name,
+                                           std::string description,
+                                           int start_val, int end_val,
+                                           int num_bins) {
+    int idx = static_cast<int>(histo_headers_.size());
+    histo_idx_.emplace(name, idx);
     int bin_width = (end_val - start_val) / num_bins;
-    bin_widths_.emplace(name, bin_width);
-    histo_bounds_.emplace(name, std::make_pair(start_val, end_val));
-    histo_counts_.emplace(name, std::unordered_map<int, uint64_t>());
-    epoch_histo_counts_.emplace(name, std::unordered_map<int, uint64_t>());
+    bin_widths_.push_back(bin_width);
+    histo_bounds_.push_back(std::make_pair(start_val, end_val));
+    // keep every value that can land in a regular bin exact so the bins
+    // below add up the same as if they were counted value by value
+    int precision = kHistoPrecision;
+    while ((2 << precision) <= end_val) {
+        precision++;
+    }
+    Histogram histo(HistoLayout::LOG_LINEAR, std::numeric_limits<int>::max(),
+                    precision);
+    histos_.push_back(histo);
+    epoch_histos_.push_back(histo);
 
     // initialize headers, descriptions
     std::vector<std::string> headers;
@@ -226,104 +358,134 @@ void SimpleStats::InitHistoStat(std::string name, std::string description,
     header = fmt::format("{}[{}-]", name, end_val);
     headers.push_back(header);
     header_descs_.emplace(header, description);
+    for (int i = 0; i < kNumPercentiles; i++) {
+        header_descs_.emplace(name + "_" + kPercentileNames[i],
+                              description + " " + kPercentileDescs[i] +
+                                  " percentile");
+    }
 
-    histo_headers_.emplace(name, headers);
+    histo_headers_.push_back(headers);
 
     // +2 for front and end
-    histo_bins_.emplace(name, std::vector<uint64_t>(num_bins + 2, 0));
-    epoch_histo_bins_.emplace(name, std::vector<uint64_t>(num_bins + 2, 0));
+    histo_bins_.emplace_back(num_bins + 2, 0);
+    epoch_histo_bins_.emplace_back(num_bins + 2, 0);
+    return HistoStatHandle(idx);
+}
+
+StatHandle SimpleStats::GetStat(const std::string& name) const {
+    auto it = counter_idx_.find(name);
+    if (it == counter_idx_.end()) {
+        std::cerr << "Unknown counter stat " << name << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    return StatHandle(it->second);
+}
+
+VecStatHandle SimpleStats::GetVecStat(const std::string& name) const {
+    auto it = vec_counter_idx_.find(name);
+    if (it == vec_counter_idx_.end()) {
+        std::cerr << "Unknown vec counter stat " << name << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    return VecStatHandle(it->second);
+}
+
+HistoStatHandle SimpleStats::GetHistoStat(const std::string& name) const {
+    auto it = histo_idx_.find(name);
+    if (it == histo_idx_.end()) {
+        std::cerr << "Unknown histogram stat " << name << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    return HistoStatHandle(it->second);
+}
+
+uint64_t& SimpleStats::Counter(const std::string& name, bool epoch) {
+    int idx = counter_idx_.at(name);
+    return epoch ? epoch_counters_[idx] : counters_[idx];
+}
+
+std::vector<uint64_t>& SimpleStats::VecCounter(const std::string& name,
+                                               bool epoch) {
+    int idx = vec_counter_idx_.at(name);
+    return epoch ? epoch_vec_counters_[idx] : vec_counters_[idx];
 }
 
 void SimpleStats::UpdateCounters() {
-    for (const auto& it : epoch_counters_) {
-        counters_[it.first] += it.second;
+    for (size_t i = 0; i < epoch_counters_.size(); i++) {
+        counters_[i] += epoch_counters_[i];
     }
-    for (const auto& vec : epoch_vec_counters_) {
-        for (size_t i = 0; i < vec.second.size(); i++) {
-            vec_counters_[vec.first][i] += vec.second[i];
+    for (size_t i = 0; i < epoch_vec_counters_.size(); i++) {
+        auto& epoch_vec = epoch_vec_counters_[i];
+        for (size_t j = 0; j < epoch_vec.size(); j++) {
+            vec_counters_[i][j] += epoch_vec[j];
         }
     }
 }
 
 void SimpleStats::UpdateHistoBins() {
-    for (auto& name_bins : epoch_histo_bins_) {
-        const auto& name = name_bins.first;
-        auto& bins = name_bins.second;
+    for (size_t idx = 0; idx < epoch_histo_bins_.size(); idx++) {
+        auto& bins = epoch_histo_bins_[idx];
+        const auto& bounds = histo_bounds_[idx];
+        int bin_width = bin_widths_[idx];
         std::fill(bins.begin(), bins.end(), 0);
-        for (const auto it : epoch_histo_counts_[name]) {
-            int value = it.first;
-            uint64_t count = it.second;
+        epoch_histos_[idx].ForEachCell([&](int value, uint64_t count) {
             int bin_idx = 0;
-            if (value < histo_bounds_[name].first) {
+            if (value < bounds.first) {
                 bin_idx = 0;
-            } else if (value > histo_bounds_[name].second) {
+            } else if (value > bounds.second) {
                 bin_idx = bins.size() - 1;
             } else {
-                bin_idx =
-                    (value - histo_bounds_[name].first) / bin_widths_[name] + 1;
+                bin_idx = (value - bounds.first) / bin_width + 1;
             }
             bins[bin_idx] += count;
-        }
-    }
+        });
 
-    // update overall histogram counts based on epoch histo counts
-    for (auto& name_counts : epoch_histo_counts_) {
-        const auto& name = name_counts.first;
-        auto& epoch_counts = name_counts.second;
-        auto& final_counts = histo_counts_[name];
-        for (const auto& val_cnt : epoch_counts) {
-            if (final_counts.count(val_cnt.first) <= 0) {
-                final_counts[val_cnt.first] = val_cnt.second;
-            } else {
-                final_counts[val_cnt.first] += val_cnt.second;
-            }
-        }
-        auto& final_bins = histo_bins_[name];
+        // update overall histogram based on epoch histogram
+        histos_[idx].Add(epoch_histos_[idx]);
+        auto& final_bins = histo_bins_[idx];
         for (size_t i = 0; i < final_bins.size(); i++) {
-            final_bins[i] += epoch_histo_bins_[name][i];
+            final_bins[i] += bins[i];
         }
     }
 }
 
-double SimpleStats::GetHistoAvg(const HistoCount& hist_counts) const {
-    uint64_t accu_sum = 0;
-    uint64_t count = 0;
-    for (auto i = hist_counts.begin(); i != hist_counts.end(); i++) {
-        accu_sum += i->first * i->second;
-        count += i->second;
-    }
-    return count == 0
-               ? 0.0
-               : static_cast<double>(accu_sum) / static_cast<double>(count);
-}
-
 void SimpleStats::UpdatePrints(bool epoch) {
     j_data_["channel"] = channel_id_;
 
-    std::unordered_map<std::string, uint64_t>& ref_counters =
-        epoch ? epoch_counters_ : counters_;
-    for (const auto& it : ref_counters) {
-        print_pairs_.emplace_back(it.first, std::to_string(it.second));
-        j_data_[it.first] = it.second;
+    const auto& ref_counters = epoch ? epoch_counters_ : counters_;
+    for (const auto& it : counter_idx_) {
+        uint64_t value = ref_counters[it.second];
+        print_pairs_.emplace_back(it.first, std::to_string(value));
+        j_data_[it.first] = value;
     }
-    j_data_["epoch_num"] = counters_["epoch_num"];
+    j_data_["epoch_num"] = Counter("epoch_num", false);
 
-    VecStat& ref_vcounter = epoch ? epoch_vec_counters_ : vec_counters_;
-    for (const auto& it : ref_vcounter) {
+    const auto& ref_vcounter = epoch ? epoch_vec_counters_ : vec_counters_;
+    for (const auto& it : vec_counter_idx_) {
+        const auto& vec = ref_vcounter[it.second];
         Json j_list;
-        for (size_t i = 0; i < it.second.size(); i++) {
+        for (size_t i = 0; i < vec.size(); i++) {
             std::string name = it.first + "." + std::to_string(i);
-            print_pairs_.emplace_back(name, std::to_string(it.second[i]));
-            j_list[std::to_string(i)] = it.second[i];
+            print_pairs_.emplace_back(name, std::to_string(vec[i]));
+            j_list[std::to_string(i)] = vec[i];
         }
         j_data_[it.first] = j_list;
     }
-    VecStat& ref_hbins = epoch ? epoch_histo_bins_ : histo_bins_;
-    for (const auto& it : ref_hbins) {
-        const auto& names = histo_headers_[it.first];
-        for (size_t i = 0; i < it.second.size(); i++) {
-            print_pairs_.emplace_back(names[i], std::to_string(it.second[i]));
-            j_data_[names[i]] = it.second[i];
+    const auto& ref_hbins = epoch ? epoch_histo_bins_ : histo_bins_;
+    const auto& ref_histos = epoch ? epoch_histos_ : histos_;
+    for (const auto& it : histo_idx_) {
+        const auto& names = histo_headers_[it.second];
+        const auto& bins = ref_hbins[it.second];
+        for (size_t i = 0; i < bins.size(); i++) {
+            print_pairs_.emplace_back(names[i], std::to_string(bins[i]));
+            j_data_[names[i]] = bins[i];
+        }
+        const auto& histo = ref_histos[it.second];
+        for (int i = 0; i < kNumPercentiles; i++) {
+            std::string name = it.first + "_" + kPercentileNames[i];
+            int value = histo.Percentile(kPercentiles[i]);
+            print_pairs_.emplace_back(name, std::to_string(value));
+            j_data_[name] = value;
         }
     }
 
@@ -331,12 +493,12 @@ void SimpleStats::UpdatePrints(bool epoch) {
     // huge therefore we only put aggregated histo in each epoch but
     // complete data at the end
     if (!epoch) {
-        for (const auto& name_hist : histo_counts_) {
+        for (const auto& it : histo_idx_) {
             Json j_list;
-            for (const auto& it : name_hist.second) {
-                j_list[std::to_string(it.first)] = it.second;
-            }
-            j_data_[name_hist.first] = j_list;
+            histos_[it.second].ForEachCell([&](int value, uint64_t count) {
+                j_list[std::to_string(value)] = count;
+            });
+            j_data_[it.first] = j_list;
         }
     }
 
@@ -366,25 +528,25 @@ void SimpleStats::UpdateEpochStats() {
 
     // update computed stats
     doubles_["act_energy"] =
-        epoch_counters_["num_act_cmds"] * config_.act_energy_inc;
+        Counter("num_act_cmds", true) * config_.act_energy_inc;
     doubles_["read_energy"] =
-        epoch_counters_["num_read_cmds"] * config_.read_energy_inc;
+        Counter("num_read_cmds", true) * config_.read_energy_inc;
     doubles_["write_energy"] =
-        epoch_counters_["num_write_cmds"] * config_.write_energy_inc;
+        Counter("num_write_cmds", true) * config_.write_energy_inc;
     doubles_["ref_energy"] =
-        epoch_counters_["num_ref_cmds"] * config_.ref_energy_inc;
+        Counter("num_ref_cmds", true) * config_.ref_energy_inc;
     doubles_["refb_energy"] =
-        epoch_counters_["num_refb_cmds"] * config_.refb_energy_inc;
+        Counter("num_refb_cmds", true) * config_.refb_energy_inc;
 
     // vector doubles, update first, then push
     double background_energy = 0.0;
     for (int i = 0; i < config_.ranks; i++) {
-        double act_stb = epoch_vec_counters_["rank_active_cycles"][i] *
+        double act_stb = VecCounter("rank_active_cycles", true)[i] *
                          config_.act_stb_energy_inc;
-        double pre_stb = epoch_vec_counters_["all_bank_idle_cycles"][i] *
+        double pre_stb = VecCounter("all_bank_idle_cycles", true)[i] *
                          config_.pre_stb_energy_inc;
         double sref_energy =
-            epoch_vec_counters_["sref_cycles"][i] * config_.sref_energy_inc;
+            VecCounter("sref_cycles", true)[i] * config_.sref_energy_inc;
         vec_doubles_["act_stb_energy"][i] = act_stb;
         vec_doubles_["pre_stb_energy"][i] = pre_stb;
         vec_doubles_["sref_energy"][i] = sref_energy;
@@ -395,8 +557,8 @@ void SimpleStats::UpdateEpochStats() {
 
     // calculated stats
     uint64_t total_reqs =
-        epoch_counters_["num_reads_done"] + epoch_counters_["num_writes_done"];
-    double total_time = epoch_counters_["num_cycles"] * config_.tCK;
+        Counter("num_reads_done", true) + Counter("num_writes_done", true);
+    double total_time = Counter("num_cycles", true) * config_.tCK;
     double avg_bw = total_reqs * config_.request_size_bytes / total_time;
     calculated_["average_bandwidth"] = avg_bw;
 
@@ -404,21 +566,20 @@ void SimpleStats::UpdateEpochStats() {
                           doubles_["write_energy"] + doubles_["ref_energy"] +
                           doubles_["refb_energy"] + background_energy;
     calculated_["total_energy"] = total_energy;
-    calculated_["average_power"] = total_energy / epoch_counters_["num_cycles"];
+    calculated_["average_power"] = total_energy / Counter("num_cycles", true);
     calculated_["average_read_latency"] =
-        GetHistoAvg(epoch_histo_counts_.at("read_latency"));
+        epoch_histos_[histo_idx_.at("read_latency")].Mean();
     calculated_["average_interarrival"] =
-        GetHistoAvg(epoch_histo_counts_.at("interarrival_latency"));
+        epoch_histos_[histo_idx_.at("interarrival_latency")].Mean();
+}
 
-    UpdatePrints(true);
-    for (auto& it : epoch_counters_) {
-        it.second = 0;
-    }
+void SimpleStats::ClearEpochStats() {
+    std::fill(epoch_counters_.begin(), epoch_counters_.end(), 0);
     for (auto& vec : epoch_vec_counters_) {
-        std::fill(vec.second.begin(), vec.second.end(), 0);
+        std::fill(vec.begin(), vec.end(), 0);
     }
-    for (auto& it : epoch_histo_counts_) {
-        it.second.clear();
+    for (auto& histo : epoch_histos_) {
+        histo.Clear();
     }
     return;
 }
@@ -427,24 +588,24 @@ void SimpleStats::UpdateFinalStats() {
     UpdateCounters();
 
     // update computed stats
-    doubles_["act_energy"] = counters_["num_act_cmds"] * config_.act_energy_inc;
+    doubles_["act_energy"] = Counter("num_act_cmds", false) * config_.act_energy_inc;
     doubles_["read_energy"] =
-        counters_["num_read_cmds"] * config_.read_energy_inc;
+        Counter("num_read_cmds", false) * config_.read_energy_inc;
     doubles_["write_energy"] =
-        counters_["num_write_cmds"] * config_.write_energy_inc;
-    doubles_["ref_energy"] = counters_["num_ref_cmds"] * config_.ref_energy_inc;
+        Counter("num_write_cmds", false) * config_.write_energy_inc;
+    doubles_["ref_energy"] = Counter("num_ref_cmds", false) * config_.ref_energy_inc;
     doubles_["refb_energy"] =
-        counters_["num_refb_cmds"] * config_.refb_energy_inc;
+        Counter("num_refb_cmds", false) * config_.refb_energy_inc;
 
     // vector doubles, update first, then push
     double background_energy = 0.0;
     for (int i = 0; i < config_.ranks; i++) {
         double act_stb =
-            vec_counters_["rank_active_cycles"][i] * config_.act_stb_energy_inc;
-        double pre_stb = vec_counters_["all_bank_idle_cycles"][i] *
+            VecCounter("rank_active_cycles", false)[i] * config_.act_stb_energy_inc;
+        double pre_stb = VecCounter("all_bank_idle_cycles", false)[i] *
                          config_.pre_stb_energy_inc;
         double sref_energy =
-            vec_counters_["sref_cycles"][i] * config_.sref_energy_inc;
+            VecCounter("sref_cycles", false)[i] * config_.sref_energy_inc;
         vec_doubles_["act_stb_energy"][i] = act_stb;
         vec_doubles_["pre_stb_energy"][i] = pre_stb;
         vec_doubles_["sref_energy"][i] = sref_energy;
@@ -456,8 +617,8 @@ void SimpleStats::UpdateFinalStats() {
 
     // calculated stats
     uint64_t total_reqs =
-        counters_["num_reads_done"] + counters_["num_writes_done"];
-    double total_time = counters_["num_cycles"] * config_.tCK;
+        Counter("num_reads_done", false) + Counter("num_writes_done", false);
+    double total_time = Counter("num_cycles", false) * config_.tCK;
     double avg_bw = total_reqs * config_.request_size_bytes / total_time;
     calculated_["average_bandwidth"] = avg_bw;
 
@@ -465,15 +626,69 @@ void SimpleStats::UpdateFinalStats() {
                           doubles_["write_energy"] + doubles_["ref_energy"] +
                           doubles_["refb_energy"] + background_energy;
     calculated_["total_energy"] = total_energy;
-    calculated_["average_power"] = total_energy / counters_["num_cycles"];
+    calculated_["average_power"] = total_energy / Counter("num_cycles", false);
     // calculated_["average_read_latency"] = GetHistoAvg("read_latency");
     calculated_["average_read_latency"] =
-        GetHistoAvg(histo_counts_.at("read_latency"));
+        histos_[histo_idx_.at("read_latency")].Mean();
     calculated_["average_interarrival"] =
-        GetHistoAvg(histo_counts_.at("interarrival_latency"));
+        histos_[histo_idx_.at("interarrival_latency")].Mean();
 
     UpdatePrints(false);
     return;
 }
 
+void SimpleStats::SaveState(CheckpointWriter& ckpt) const {
+    ckpt.Put(counters_);
+    ckpt.Put(epoch_counters_);
+    ckpt.Put(vec_counters_);
+    ckpt.Put(epoch_vec_counters_);
+    ckpt.Put(static_cast<uint64_t>(histos_.size()));
+    for (size_t i = 0; i < histos_.size(); i++) {
+        histos_[i].SaveState(ckpt);
+        epoch_histos_[i].SaveState(ckpt);
+    }
+    // epoch bins are recomputed every epoch, the overall ones accumulate
+    ckpt.Put(histo_bins_);
+}
+
+void SimpleStats::RestoreState(CheckpointReader& ckpt) {
+    // same stats are registered for every config so the shapes must match
+    VecCount vec_counters, epoch_vec_counters, histo_bins;
+    std::vector<uint64_t> counters, epoch_counters;
+    ckpt.Get(counters);
+    ckpt.Get(epoch_counters);
+    ckpt.Get(vec_counters);
+    ckpt.Get(epoch_vec_counters);
+    ckpt.ExpectSize(histos_.size());
+    for (size_t i = 0; i < histos_.size(); i++) {
+        histos_[i].RestoreState(ckpt);
+        epoch_histos_[i].RestoreState(ckpt);
+    }
+    ckpt.Get(histo_bins);
+    auto same_shape = [](const VecCount& a, const VecCount& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i].size() != b[i].size()) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (counters.size() != counters_.size() ||
+        epoch_counters.size() != epoch_counters_.size() ||
+        !same_shape(vec_counters, vec_counters_) ||
+        !same_shape(epoch_vec_counters, epoch_vec_counters_) ||
+        !same_shape(histo_bins, histo_bins_)) {
+        ckpt.Fail();
+        return;
+    }
+    counters_.swap(counters);
+    epoch_counters_.swap(epoch_counters);
+    vec_counters_.swap(vec_counters);
+    epoch_vec_counters_.swap(epoch_vec_counters);
+    histo_bins_.swap(histo_bins);
+}
+
 }  // namespace dramsim3
\ No newline at end of file
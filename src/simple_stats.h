@@ -6,35 +6,102 @@
 #include <unordered_map>
 #include <vector>
 
+#include "checkpoint.h"
+#include "column_writer.h"
 #include "configuration.h"
+#include "histogram.h"
 #include "json.hpp"
+#include "stats_writer.h"
 
 namespace dramsim3 {
 
+// Handles to registered stats, updating a stat through its handle indexes a
+// flat array instead of hashing the stat name so they should be resolved once
+// up front (by registering the stat or looking it up) and kept around
+struct StatHandle {
+    StatHandle() : idx(-1) {}
+    explicit StatHandle(int idx) : idx(idx) {}
+    bool IsValid() const { return idx >= 0; }
+    int idx;
+};
+
+struct VecStatHandle {
+    VecStatHandle() : idx(-1) {}
+    explicit VecStatHandle(int idx) : idx(idx) {}
+    bool IsValid() const { return idx >= 0; }
+    int idx;
+};
+
+struct HistoStatHandle {
+    HistoStatHandle() : idx(-1) {}
+    explicit HistoStatHandle(int idx) : idx(idx) {}
+    bool IsValid() const { return idx >= 0; }
+    int idx;
+};
+
 class SimpleStats {
    public:
     SimpleStats(const Config& config, int channel_id);
+
+    // register stats, only counter type stats get a valid StatHandle
+    StatHandle InitStat(std::string name, std::string stat_type,
+                        std::string description);
+    VecStatHandle InitVecStat(std::string name, std::string stat_type,
+                              std::string description, std::string part_name,
+                              int vec_len);
+    HistoStatHandle InitHistoStat(std::string name, std::string description,
+                                  int start_val, int end_val, int num_bins);
+
+    // look up handles of stats that are already registered
+    StatHandle GetStat(const std::string& name) const;
+    VecStatHandle GetVecStat(const std::string& name) const;
+    HistoStatHandle GetHistoStat(const std::string& name) const;
+
     // incrementing counter
-    void Increment(const std::string name) { epoch_counters_[name] += 1; }
+    void Increment(StatHandle stat) { epoch_counters_[stat.idx] += 1; }
+
+    // increment counter by number
+    void IncrementBy(StatHandle stat, uint64_t num) {
+        epoch_counters_[stat.idx] += num;
+    }
 
     // incrementing for vec counter
-    void IncrementVec(const std::string name, int pos) {
-        epoch_vec_counters_[name][pos] += 1;
+    void IncrementVec(VecStatHandle stat, int pos) {
+        epoch_vec_counters_[stat.idx][pos] += 1;
     }
 
     // increment vec counter by number
-    void IncrementVecBy(const std::string name, int pos, int num) {
-        epoch_vec_counters_[name][pos] += num;
+    void IncrementVecBy(VecStatHandle stat, int pos, uint64_t num) {
+        epoch_vec_counters_[stat.idx][pos] += num;
     }
 
     // add historgram value
-    void AddValue(const std::string name, const int value);
+    void AddValue(HistoStatHandle stat, const int value) {
+        epoch_histos_[stat.idx].AddValue(value);
+    }
+
+    // name based versions of the above, these look up the name every call so
+    // keep them out of the per cycle/per command paths
+    void Increment(const std::string& name) { Increment(GetStat(name)); }
+    void IncrementBy(const std::string& name, uint64_t num) {
+        IncrementBy(GetStat(name), num);
+    }
+    void IncrementVec(const std::string& name, int pos) {
+        IncrementVec(GetVecStat(name), pos);
+    }
+    void IncrementVecBy(const std::string& name, int pos, uint64_t num) {
+        IncrementVecBy(GetVecStat(name), pos, num);
+    }
+    void AddValue(const std::string& name, const int value) {
+        AddValue(GetHistoStat(name), value);
+    }
 
     // return per rank background energy
     double RankBackgroundEnergy(const int r) const;
 
-    // Epoch update
-    void PrintEpochStats();
+    // Epoch update, the stats go to json_out as one line and/or to
+    // column_out as one row depending on the config
+    void PrintEpochStats(StatsWriter& json_out, ColumnWriter& column_out);
 
     // Final statas output
     void PrintFinalStats();
@@ -42,39 +109,41 @@ class SimpleStats {
     // Reset (usually after one phase of simulation)
     void Reset();
 
+    // counts and samples so far, overall and of the current epoch
+    void SaveState(CheckpointWriter& ckpt) const;
+    void RestoreState(CheckpointReader& ckpt);
+
    private:
-    using VecStat = std::unordered_map<std::string, std::vector<uint64_t> >;
-    using HistoCount = std::unordered_map<int, uint64_t>;
+    using VecCount = std::vector<std::vector<uint64_t> >;
     using Json = nlohmann::json;
-    void InitStat(std::string name, std::string stat_type,
-                  std::string description);
-    void InitVecStat(std::string name, std::string stat_type,
-                     std::string description, std::string part_name,
-                     int vec_len);
-    void InitHistoStat(std::string name, std::string description, int start_val,
-                       int end_val, int num_bins);
 
     void UpdateCounters();
     void UpdateHistoBins();
     void UpdatePrints(bool epoch);
-    double GetHistoAvg(const HistoCount& histo_counts) const;
     std::string GetTextHeader(bool is_final) const;
     void UpdateEpochStats();
+    void ClearEpochStats();
     void UpdateFinalStats();
 
+    // access counters by name where speed does not matter
+    uint64_t& Counter(const std::string& name, bool epoch);
+    std::vector<uint64_t>& VecCounter(const std::string& name, bool epoch);
+
     const Config& config_;
     int channel_id_;
 
     // map names to descriptions
     std::unordered_map<std::string, std::string> header_descs_;
 
-    // counter stats, indexed by their name
-    std::unordered_map<std::string, uint64_t> counters_;
-    std::unordered_map<std::string, uint64_t> epoch_counters_;
+    // counter stats, names map to indices of the flat counter arrays
+    std::unordered_map<std::string, int> counter_idx_;
+    std::vector<uint64_t> counters_;
+    std::vector<uint64_t> epoch_counters_;
 
-    // vectored counter stats, first indexed by name then by index
-    VecStat vec_counters_;
-    VecStat epoch_vec_counters_;
+    // vectored counter stats, first indexed by handle then by position
+    std::unordered_map<std::string, int> vec_counter_idx_;
+    VecCount vec_counters_;
+    VecCount epoch_vec_counters_;
 
     // NOTE: doubles_ vec_doubles_ and calculated_ are basically one time
     // placeholders after each epoch they store the value for that epoch
@@ -86,17 +155,40 @@ class SimpleStats {
     // calculated stats, similar to double, but not the same
     std::unordered_map<std::string, double> calculated_;
 
-    // histogram stats
-    std::unordered_map<std::string, std::vector<std::string> > histo_headers_;
-
-    std::unordered_map<std::string, std::pair<int, int> > histo_bounds_;
-    std::unordered_map<std::string, int> bin_widths_;
-    std::unordered_map<std::string, HistoCount> histo_counts_;
-    std::unordered_map<std::string, HistoCount> epoch_histo_counts_;
-    VecStat histo_bins_;
-    VecStat epoch_histo_bins_;
+    // histogram stats, indexed by handle
+    std::unordered_map<std::string, int> histo_idx_;
+    std::vector<std::vector<std::string> > histo_headers_;
+
+    std::vector<std::pair<int, int> > histo_bounds_;
+    std::vector<int> bin_widths_;
+    std::vector<Histogram> histos_;
+    std::vector<Histogram> epoch_histos_;
+    VecCount histo_bins_;
+    VecCount epoch_histo_bins_;
+
+    // where the value of each epoch column comes from
+    struct ColumnSource {
+        enum Kind {
+            CHANNEL,
+            COUNTER,
+            EPOCH_NUM,
+            VEC_COUNTER,
+            HISTO_BIN,
+            PERCENTILE,
+            DOUBLE
+        };
+        Kind kind;
+        int idx;
+        int pos;
+        const double* value;
+    };
+    void InitEpochColumns();
+    const std::vector<uint64_t>& EpochRow();
 
     // outputs
+    std::vector<Column> epoch_columns_;
+    std::vector<ColumnSource> column_sources_;
+    std::vector<uint64_t> epoch_row_;
     Json j_data_;
     std::vector<std::pair<std::string, std::string> > print_pairs_;
 };
@@ -0,0 +1,87 @@
+#ifndef __SPSC_RING_H
+#define __SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace dramsim3 {
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. The producer only writes tail_ and the consumer only
+// writes head_, so a push or a pop is one acquire load and one release store.
+// Capacity is rounded up to a power of 2.
+template <typename T>
+class SpscRing {
+   public:
+    SpscRing(size_t capacity) : head_(0), tail_(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    // producer side, false if the ring is full
+    bool TryPush(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return false;
+        }
+        slots_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, false if the ring is empty
+    bool TryPop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // producer side, push as many of items as fit, returns how many
+    size_t TryPushBulk(const T* items, size_t count) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t space =
+            slots_.size() - (tail - head_.load(std::memory_order_acquire));
+        size_t num_items = count < space ? count : space;
+        for (size_t i = 0; i < num_items; i++) {
+            slots_[(tail + i) & mask_] = items[i];
+        }
+        tail_.store(tail + num_items, std::memory_order_release);
+        return num_items;
+    }
+
+    // consumer side, pop up to max_items into items, returns how many
+    size_t TryPopBulk(T* items, size_t max_items) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t avail = tail_.load(std::memory_order_acquire) - head;
+        size_t num_items = max_items < avail ? max_items : avail;
+        for (size_t i = 0; i < num_items; i++) {
+            items[i] = slots_[(head + i) & mask_];
+        }
+        head_.store(head + num_items, std::memory_order_release);
+        return num_items;
+    }
+
+    size_t Capacity() const { return slots_.size(); }
+
+   private:
+    std::vector<T> slots_;
+    size_t mask_;
+    // pad the two indices onto separate cache lines so the threads don't
+    // bounce one line back and forth
+    char pad0_[64];
+    std::atomic<size_t> head_;
+    char pad1_[64];
+    std::atomic<size_t> tail_;
+};
+
+}  // namespace dramsim3
+#endif
@@ -0,0 +1,90 @@
+#include "stats_writer.h"
+
+#include <iostream>
+
+namespace dramsim3 {
+
+namespace {
+// buffer size at which WriteLine hands the buffer to the writer thread
+const size_t kHandOverSize = 1 << 20;
+}  // namespace
+
+StatsWriter::StatsWriter(const std::string& file_name)
+    : file_name_(file_name), busy_(false), stop_(false) {}
+
+StatsWriter::~StatsWriter() {
+    if (!writer_.joinable()) {
+        return;
+    }
+    HandOver();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    writer_.join();
+}
+
+void StatsWriter::Write(const char* data, size_t size) {
+    if (!writer_.joinable()) {
+        writer_ = std::thread(&StatsWriter::WriterLoop, this);
+    }
+    buffer_.append(data, size);
+    if (buffer_.size() >= kHandOverSize) {
+        HandOver();
+    }
+}
+
+void StatsWriter::WriteLine(const std::string& line) {
+    Write(line.data(), line.size());
+    Write("\n", 1);
+}
+
+void StatsWriter::Flush() {
+    if (!writer_.joinable()) {
+        return;
+    }
+    HandOver();
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return pending_.empty() && !busy_; });
+}
+
+void StatsWriter::HandOver() {
+    if (buffer_.empty()) {
+        return;
+    }
+    {
+        // at most one buffer waits for the writer, more would only pile up
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return pending_.empty(); });
+        pending_.swap(buffer_);
+    }
+    cond_.notify_all();
+}
+
+void StatsWriter::WriterLoop() {
+    std::ofstream out(file_name_, std::ofstream::out | std::ofstream::binary);
+    if (!out) {
+        std::cerr << "WARNING: Cannot write " << file_name_ << std::endl;
+    }
+    std::string writing;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cond_.wait(lock, [this] { return !pending_.empty() || stop_; });
+        if (pending_.empty()) {
+            break;
+        }
+        writing.swap(pending_);
+        busy_ = true;
+        lock.unlock();
+        cond_.notify_all();
+        out.write(writing.data(), writing.size());
+        out.flush();
+        writing.clear();
+        lock.lock();
+        busy_ = false;
+        cond_.notify_all();
+    }
+}
+
+}  // namespace dramsim3
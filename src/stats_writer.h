@@ -0,0 +1,45 @@
+#ifndef __STATS_WRITER_H
+#define __STATS_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace dramsim3 {
+
+// Writes to one file that stays open for the whole run, e.g. the JSON lines
+// of the epoch stats. Writes only append to a buffer, a full buffer is
+// handed to a writer thread that does the file I/O while the next one fills
+// up. The file is (re)created and the thread started by the first write,
+// nothing is touched for outputs that are never written.
+class StatsWriter {
+   public:
+    explicit StatsWriter(const std::string& file_name);
+    ~StatsWriter();
+    void Write(const char* data, size_t size);
+    void WriteLine(const std::string& line);
+    // wait until everything written so far is in the file
+    void Flush();
+
+   private:
+    std::string file_name_;
+    // filled by Write
+    std::string buffer_;
+
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    // handed over to the writer thread, empty once it has taken it
+    std::string pending_;
+    bool busy_;
+    bool stop_;
+
+    void HandOver();
+    void WriterLoop();
+};
+
+}  // namespace dramsim3
+#endif
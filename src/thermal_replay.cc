@@ -9,7 +9,9 @@ ThermalReplay::ThermalReplay(std::string trace_name, std::string config_file,
     : config_(config_file, output_dir),
       thermal_calc_(config_),
       repeat_(repeat),
-      last_clk_(0) {
+      last_clk_(0),
+      epoch_out_(config_.json_epoch_name),
+      epoch_columns_(config_.columnar_epoch_name) {
     for (int i = 0; i < config_.channels; i++) {
         channel_stats_.emplace_back(config_, i);
     }
@@ -188,7 +190,7 @@ void ThermalReplay::ProcessCMD(Command &cmd, uint64_t clk) {
         for (int c = 0; c < config_.channels; c++) {
             // where to print isn't important here what we really need is the
             // updated stats
-            channel_stats_[c].PrintEpochStats();
+            channel_stats_[c].PrintEpochStats(epoch_out_, epoch_columns_);
             for (int r = 0; r < config_.ranks; r++) {
                 double bg_energy = channel_stats_[c].RankBackgroundEnergy(r);
                 thermal_calc_.UpdateBackgroundEnergy(c, r, bg_energy);
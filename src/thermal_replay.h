@@ -26,6 +26,8 @@ class ThermalReplay {
     uint64_t repeat_;
     uint64_t last_clk_;
     std::vector<SimpleStats> channel_stats_;
+    StatsWriter epoch_out_;
+    ColumnWriter epoch_columns_;
     std::vector<std::vector<std::vector<std::vector<bool>>>> bank_active_;
     void ParseLine(std::string line, uint64_t &clk, Command &cmd);
     void ProcessCMD(Command &cmd, uint64_t clk);
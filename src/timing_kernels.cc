@@ -0,0 +1,110 @@
+#include "timing_kernels.h"
+
+#include <algorithm>
+
+#ifdef DRAMSIM3_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace dramsim3 {
+
+template <int kLanes>
+void MaxRowsScalar(uint64_t* dst, size_t num_rows, const uint64_t* row) {
+    for (size_t i = 0; i < num_rows; i++) {
+        for (int j = 0; j < kLanes; j++) {
+            dst[j] = std::max(dst[j], row[j]);
+        }
+        dst += kTimingRowSize;
+    }
+}
+
+#ifdef DRAMSIM3_X86_KERNELS
+// There is no unsigned 64 bit compare before AVX-512, flipping the sign bit
+// of both sides turns the signed pcmpgtq into one
+
+template <int kLanes>
+__attribute__((target("sse4.2"))) void MaxRowsSSE42(uint64_t* dst,
+                                                    size_t num_rows,
+                                                    const uint64_t* row) {
+    const int vecs = kLanes / 2;
+    const __m128i sign = _mm_set1_epi64x(static_cast<int64_t>(1ULL << 63));
+    __m128i r[vecs], r_biased[vecs];
+    for (int j = 0; j < vecs; j++) {
+        r[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row) + j);
+        r_biased[j] = _mm_xor_si128(r[j], sign);
+    }
+    for (size_t i = 0; i < num_rows; i++) {
+        __m128i* d = reinterpret_cast<__m128i*>(dst);
+        for (int j = 0; j < vecs; j++) {
+            __m128i t = _mm_loadu_si128(d + j);
+            __m128i row_later =
+                _mm_cmpgt_epi64(r_biased[j], _mm_xor_si128(t, sign));
+            _mm_storeu_si128(d + j, _mm_blendv_epi8(t, r[j], row_later));
+        }
+        dst += kTimingRowSize;
+    }
+}
+
+template <int kLanes>
+__attribute__((target("avx2"))) void MaxRowsAVX2(uint64_t* dst,
+                                                 size_t num_rows,
+                                                 const uint64_t* row) {
+    const int vecs = kLanes / 4;
+    const __m256i sign = _mm256_set1_epi64x(static_cast<int64_t>(1ULL << 63));
+    __m256i r[vecs], r_biased[vecs];
+    for (int j = 0; j < vecs; j++) {
+        r[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row) + j);
+        r_biased[j] = _mm256_xor_si256(r[j], sign);
+    }
+    for (size_t i = 0; i < num_rows; i++) {
+        __m256i* d = reinterpret_cast<__m256i*>(dst);
+        for (int j = 0; j < vecs; j++) {
+            __m256i t = _mm256_loadu_si256(d + j);
+            __m256i row_later =
+                _mm256_cmpgt_epi64(r_biased[j], _mm256_xor_si256(t, sign));
+            _mm256_storeu_si256(d + j,
+                                _mm256_blendv_epi8(t, r[j], row_later));
+        }
+        dst += kTimingRowSize;
+    }
+}
+#endif  // DRAMSIM3_X86_KERNELS
+
+MaxRowsKernel SelectMaxRowsKernel(int lanes) {
+    // index of the narrowest instance covering lanes
+    int width = std::min(std::max(lanes - 1, 0) / 4, 3);
+#ifdef DRAMSIM3_X86_KERNELS
+    static const MaxRowsKernel avx2[] = {MaxRowsAVX2<4>, MaxRowsAVX2<8>,
+                                         MaxRowsAVX2<12>, MaxRowsAVX2<16>};
+    static const MaxRowsKernel sse42[] = {MaxRowsSSE42<4>, MaxRowsSSE42<8>,
+                                          MaxRowsSSE42<12>, MaxRowsSSE42<16>};
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return avx2[width];
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return sse42[width];
+    }
+#endif
+    static const MaxRowsKernel scalar[] = {MaxRowsScalar<4>, MaxRowsScalar<8>,
+                                           MaxRowsScalar<12>,
+                                           MaxRowsScalar<16>};
+    return scalar[width];
+}
+
+template void MaxRowsScalar<4>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsScalar<8>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsScalar<12>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsScalar<16>(uint64_t*, size_t, const uint64_t*);
+#ifdef DRAMSIM3_X86_KERNELS
+template void MaxRowsSSE42<4>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsSSE42<8>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsSSE42<12>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsSSE42<16>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsAVX2<4>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsAVX2<8>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsAVX2<12>(uint64_t*, size_t, const uint64_t*);
+template void MaxRowsAVX2<16>(uint64_t*, size_t, const uint64_t*);
+#endif
+
+}  // namespace dramsim3
@@ -0,0 +1,43 @@
+#ifndef __TIMING_KERNELS_H
+#define __TIMING_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dramsim3 {
+
+// Number of slots in a bank's row of the ChannelState timing table, the
+// kernels below work on whole rows
+const int kTimingRowSize = 16;
+
+// dst[i * kTimingRowSize + j] = max(dst[i * kTimingRowSize + j], row[j])
+// for i < num_rows and j < kLanes, i.e. apply the first kLanes deadlines of
+// one row to num_rows consecutive banks. kLanes is a multiple of 4 up to
+// kTimingRowSize so each instance is fully unrolled. All versions compare as
+// uint64_t and give identical results.
+typedef void (*MaxRowsKernel)(uint64_t* dst, size_t num_rows,
+                              const uint64_t* row);
+
+template <int kLanes>
+void MaxRowsScalar(uint64_t* dst, size_t num_rows, const uint64_t* row);
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DRAMSIM3_X86_KERNELS
+// compiled for their instruction sets regardless of the build flags, only
+// call them if the CPU supports it
+template <int kLanes>
+__attribute__((target("sse4.2"))) void MaxRowsSSE42(uint64_t* dst,
+                                                    size_t num_rows,
+                                                    const uint64_t* row);
+template <int kLanes>
+__attribute__((target("avx2"))) void MaxRowsAVX2(uint64_t* dst,
+                                                 size_t num_rows,
+                                                 const uint64_t* row);
+#endif
+
+// The fastest kernel the CPU we are running on supports that covers at
+// least the first lanes slots of a row
+MaxRowsKernel SelectMaxRowsKernel(int lanes);
+
+}  // namespace dramsim3
+#endif
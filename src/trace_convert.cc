@@ -0,0 +1,68 @@
+#include <iostream>
+#include "./../ext/headers/args.hxx"
+#include "trace_reader.h"
+
+using namespace dramsim3;
+
+int main(int argc, const char **argv) {
+    args::ArgumentParser parser(
+        "Convert DRAMSim3 traces between the text and the binary format.",
+        "Text traces become binary and binary traces become text, e.g.\n"
+        "./build/traceconvert sample_trace.txt sample_trace.bin");
+    args::HelpFlag help(parser, "help", "Display the help menu", {'h', "help"});
+    args::Positional<std::string> input_arg(parser, "input",
+                                            "Input trace file (mandatory)");
+    args::Positional<std::string> output_arg(parser, "output",
+                                             "Output trace file (mandatory)");
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (const args::Help &) {
+        std::cout << parser;
+        return 0;
+    } catch (const args::ParseError &e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::string input = args::get(input_arg);
+    std::string output = args::get(output_arg);
+    if (input.empty() || output.empty()) {
+        std::cerr << parser;
+        return 1;
+    }
+
+    bool to_text = IsBinaryTrace(input);
+    auto reader = OpenTraceReader(input);
+    std::ofstream out(output, to_text ? std::ios::out : std::ios::binary);
+    if (out.fail()) {
+        std::cerr << "Cannot open " << output << std::endl;
+        return 1;
+    }
+
+    uint64_t count = 0;
+    Transaction trans;
+    bool depends;
+    if (to_text) {
+        while (reader->Next(trans, depends)) {
+            out << "0x" << std::hex << std::uppercase << trans.addr
+                << std::dec << (trans.is_write ? " WRITE " : " READ ")
+                << trans.added_cycle << (depends ? " DEP\n" : "\n");
+            count++;
+        }
+    } else {
+        BinaryTraceWriter writer(out);
+        while (reader->Next(trans, depends)) {
+            writer.Write(trans, depends);
+            count++;
+        }
+    }
+    out.close();
+    if (out.fail()) {
+        std::cerr << "Error writing " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Converted " << count << " transactions" << std::endl;
+    return 0;
+}
@@ -0,0 +1,598 @@
+#include "trace_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+#ifdef GZIP_TRACE
+#include <zlib.h>
+#endif  // GZIP_TRACE
+#ifdef ZSTD_TRACE
+#include <zstd.h>
+#endif  // ZSTD_TRACE
+
+namespace dramsim3 {
+
+namespace {
+
+// transactions a fanout decodes at a time
+const size_t kFanoutChunkSize = 4096;
+
+uint64_t ZigZag(uint64_t delta) {
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+uint64_t UnZigZag(uint64_t value) { return (value >> 1) ^ (0 - (value & 1)); }
+
+void PutVarint(std::ostream& os, uint64_t value) {
+    char buf[10];
+    int len = 0;
+    while (value >= 0x80) {
+        buf[len++] = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    buf[len++] = static_cast<char>(value);
+    os.write(buf, len);
+}
+
+// false if the buffer ends in the middle of the varint
+bool GetVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; pos < end && shift < 64; shift += 7) {
+        uint8_t byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PutUint32(char* buf, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        buf[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+uint32_t GetUint32(const uint8_t* buf) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(buf[i]) << (8 * i);
+    }
+    return value;
+}
+
+// Cycle deltas are shifted by 1 (is_write) in version 1 and by 2 (depends,
+// is_write) from version 2 on, 0 for unknown versions
+int RecordFlagBits(uint32_t version) {
+    if (version == 1) {
+        return 1;
+    }
+    return version == kTraceVersion ? 2 : 0;
+}
+
+// false if the record is cut off, pos is left where it was then
+bool DecodeRecord(const uint8_t*& pos, const uint8_t* end, int flag_bits,
+                  uint64_t& last_cycle, uint64_t& last_addr,
+                  Transaction& trans, bool& depends) {
+    const uint8_t* next = pos;
+    uint64_t cycle_op = 0, addr_delta = 0;
+    if (!GetVarint(next, end, cycle_op) || !GetVarint(next, end, addr_delta)) {
+        return false;
+    }
+    pos = next;
+    last_cycle += UnZigZag(cycle_op >> flag_bits);
+    last_addr += UnZigZag(addr_delta);
+    trans.addr = last_addr;
+    trans.added_cycle = last_cycle;
+    trans.is_write = (cycle_op & 1) != 0;
+    depends = flag_bits > 1 && (cycle_op & 2) != 0;
+    return true;
+}
+
+bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Same fields as operator>>(istream&, Transaction&) plus the optional DEP
+// marker out of one text line, the line must end with '\n'. false for blank
+// lines
+bool ParseTextRecord(const char* line, Transaction& trans, bool& depends) {
+    const char* pos = line;
+    while (IsSpace(*pos)) pos++;
+    if (*pos == '\n') {
+        return false;
+    }
+    char* next;
+    trans.addr = strtoull(pos, &next, 16);
+    bool good = next != pos;
+    pos = next;
+    while (IsSpace(*pos)) pos++;
+    const char* op = pos;
+    while (!IsSpace(*pos) && *pos != '\n') pos++;
+    size_t op_len = pos - op;
+    while (IsSpace(*pos)) pos++;
+    // strtoull would skip the newline and read on into the next line
+    good = good && op_len > 0 && *pos >= '0' && *pos <= '9';
+    trans.added_cycle = strtoull(pos, &next, 10);
+    pos = next;
+    while (IsSpace(*pos)) pos++;
+    depends = false;
+    if (*pos != '\n') {
+        const char* marker = pos;
+        while (!IsSpace(*pos) && *pos != '\n') pos++;
+        depends = pos - marker == 3 && memcmp(marker, "DEP", 3) == 0;
+        while (IsSpace(*pos)) pos++;
+        good = good && depends && *pos == '\n';
+    }
+    if (!good) {
+        std::cerr << "Malformed trace line: "
+                  << std::string(line, strchr(line, '\n')) << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    static const char* write_types[] = {"WRITE", "write", "P_MEM_WR", "BOFF"};
+    trans.is_write = false;
+    for (auto write_type : write_types) {
+        if (op_len == strlen(write_type) &&
+            memcmp(op, write_type, op_len) == 0) {
+            trans.is_write = true;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+// Fills a buffer with the next chunk of decompressed bytes, 0 at the end
+class TraceDecompressor {
+   public:
+    virtual ~TraceDecompressor() {}
+    virtual size_t Read(char* buf, size_t size) = 0;
+};
+
+namespace {
+
+#ifdef GZIP_TRACE
+class GzipDecompressor : public TraceDecompressor {
+   public:
+    GzipDecompressor(const std::string& trace_file)
+        : file_(gzopen(trace_file.c_str(), "rb")) {
+        if (file_ == nullptr) {
+            std::cerr << "Trace file does not exist" << std::endl;
+            AbruptExit(__FILE__, __LINE__);
+        }
+        gzbuffer(file_, 1 << 17);
+    }
+    ~GzipDecompressor() { gzclose(file_); }
+
+    size_t Read(char* buf, size_t size) override {
+        int len = gzread(file_, buf, static_cast<unsigned>(size));
+        if (len < 0) {
+            int err;
+            std::cerr << "Corrupt gzip trace: " << gzerror(file_, &err)
+                      << std::endl;
+            AbruptExit(__FILE__, __LINE__);
+        }
+        return static_cast<size_t>(len);
+    }
+
+   private:
+    gzFile file_;
+};
+#endif  // GZIP_TRACE
+
+#ifdef ZSTD_TRACE
+class ZstdDecompressor : public TraceDecompressor {
+   public:
+    ZstdDecompressor(const std::string& trace_file)
+        : file_(fopen(trace_file.c_str(), "rb")),
+          stream_(ZSTD_createDStream()),
+          in_buf_(ZSTD_DStreamInSize()),
+          frame_done_(true) {
+        if (file_ == nullptr) {
+            std::cerr << "Trace file does not exist" << std::endl;
+            AbruptExit(__FILE__, __LINE__);
+        }
+        ZSTD_initDStream(stream_);
+        in_.src = in_buf_.data();
+        in_.size = 0;
+        in_.pos = 0;
+    }
+    ~ZstdDecompressor() {
+        ZSTD_freeDStream(stream_);
+        fclose(file_);
+    }
+
+    size_t Read(char* buf, size_t size) override {
+        ZSTD_outBuffer out = {buf, size, 0};
+        while (out.pos == 0) {
+            if (in_.pos == in_.size) {
+                in_.size = fread(in_buf_.data(), 1, in_buf_.size(), file_);
+                in_.pos = 0;
+                if (in_.size == 0) {
+                    if (!frame_done_) {
+                        std::cerr << "Truncated zstd trace" << std::endl;
+                        AbruptExit(__FILE__, __LINE__);
+                    }
+                    return 0;
+                }
+            }
+            size_t ret = ZSTD_decompressStream(stream_, &out, &in_);
+            if (ZSTD_isError(ret)) {
+                std::cerr << "Corrupt zstd trace: " << ZSTD_getErrorName(ret)
+                          << std::endl;
+                AbruptExit(__FILE__, __LINE__);
+            }
+            frame_done_ = ret == 0;
+        }
+        return out.pos;
+    }
+
+   private:
+    FILE* file_;
+    ZSTD_DStream* stream_;
+    std::vector<char> in_buf_;
+    ZSTD_inBuffer in_;
+    bool frame_done_;
+};
+#endif  // ZSTD_TRACE
+
+TraceDecompressor* NewDecompressor(const std::string& trace_file,
+                                   TraceCompression compression) {
+#ifdef GZIP_TRACE
+    if (compression == TraceCompression::GZIP) {
+        return new GzipDecompressor(trace_file);
+    }
+#endif  // GZIP_TRACE
+#ifdef ZSTD_TRACE
+    if (compression == TraceCompression::ZSTD) {
+        return new ZstdDecompressor(trace_file);
+    }
+#endif  // ZSTD_TRACE
+    std::cerr << trace_file << " is compressed, rebuild with "
+              << (compression == TraceCompression::GZIP ? "zlib"
+                                                         : "-DZSTD=1")
+              << " to read it" << std::endl;
+    AbruptExit(__FILE__, __LINE__);
+    return nullptr;
+}
+
+}  // namespace
+
+TextTraceReader::TextTraceReader(const std::string& trace_file)
+    : trace_file_(trace_file) {
+    if (trace_file_.fail()) {
+        std::cerr << "Trace file does not exist" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+}
+
+bool TextTraceReader::Next(Transaction& trans, bool& depends) {
+    while (std::getline(trace_file_, line_)) {
+        line_.push_back('\n');
+        if (ParseTextRecord(line_.c_str(), trans, depends)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+BinaryTraceReader::BinaryTraceReader(const std::string& trace_file)
+    : map_(MAP_FAILED),
+      map_size_(0),
+      last_cycle_(0),
+      last_addr_(0),
+      flag_bits_(0) {
+    int fd = open(trace_file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Trace file does not exist" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0) {
+        map_size_ = static_cast<size_t>(file_stat.st_size);
+    }
+    if (map_size_ >= kTraceHeaderSize) {
+        map_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map_ == MAP_FAILED) {
+        std::cerr << "Cannot map binary trace " << trace_file << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+    pos_ = static_cast<const uint8_t*>(map_);
+    end_ = pos_ + map_size_;
+    if (memcmp(pos_, kTraceMagic, kTraceMagicSize) == 0) {
+        flag_bits_ = RecordFlagBits(GetUint32(pos_ + kTraceMagicSize));
+    }
+    if (flag_bits_ == 0) {
+        std::cerr << trace_file << " is not a version 1-" << kTraceVersion
+                  << " binary trace" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    pos_ += kTraceHeaderSize;
+}
+
+BinaryTraceReader::~BinaryTraceReader() { munmap(map_, map_size_); }
+
+bool BinaryTraceReader::Next(Transaction& trans, bool& depends) {
+    if (pos_ >= end_) {
+        return false;
+    }
+    if (!DecodeRecord(pos_, end_, flag_bits_, last_cycle_, last_addr_, trans,
+                      depends)) {
+        std::cerr << "Truncated binary trace" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    return true;
+}
+
+StreamingTraceReader::StreamingTraceReader(const std::string& trace_file,
+                                           TraceCompression compression)
+    : source_(NewDecompressor(trace_file, compression)),
+      ring_(1 << 16),
+      done_(false),
+      stop_(false) {
+    decoder_ = std::thread(&StreamingTraceReader::DecodeLoop, this);
+}
+
+StreamingTraceReader::~StreamingTraceReader() {
+    stop_.store(true);
+    decoder_.join();
+}
+
+bool StreamingTraceReader::Next(Transaction& trans, bool& depends) {
+    Record record;
+    while (!ring_.TryPop(record)) {
+        // the decoder may have pushed its last ones after our pop
+        if (done_.load(std::memory_order_acquire) && !ring_.TryPop(record)) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    trans = record.trans;
+    depends = record.depends;
+    return true;
+}
+
+void StreamingTraceReader::Push(const Record& record) {
+    while (!ring_.TryPush(record)) {
+        if (stop_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void StreamingTraceReader::DecodeLoop() {
+    // one byte is kept spare to end a last line without a newline
+    std::vector<char> buf(1 << 20);
+    size_t filled = 0;
+    bool header_checked = false;
+    bool binary = false;
+    int flag_bits = 0;
+    uint64_t last_cycle = 0, last_addr = 0;
+    Record record;
+    while (!stop_.load(std::memory_order_relaxed)) {
+        size_t len = source_->Read(buf.data() + filled, buf.size() - 1 - filled);
+        bool eof = len == 0;
+        filled += len;
+        size_t consumed = 0;
+        if (!header_checked) {
+            if (filled < kTraceHeaderSize && !eof) {
+                continue;
+            }
+            header_checked = true;
+            binary = filled >= kTraceHeaderSize &&
+                     memcmp(buf.data(), kTraceMagic, kTraceMagicSize) == 0;
+            if (binary) {
+                flag_bits = RecordFlagBits(GetUint32(
+                    reinterpret_cast<const uint8_t*>(buf.data()) +
+                    kTraceMagicSize));
+                if (flag_bits == 0) {
+                    std::cerr << "Not a version 1-" << kTraceVersion
+                              << " binary trace" << std::endl;
+                    AbruptExit(__FILE__, __LINE__);
+                }
+                consumed = kTraceHeaderSize;
+            }
+        }
+
+        if (binary) {
+            const uint8_t* begin = reinterpret_cast<const uint8_t*>(buf.data());
+            const uint8_t* pos = begin + consumed;
+            const uint8_t* end = begin + filled;
+            while (DecodeRecord(pos, end, flag_bits, last_cycle, last_addr,
+                                record.trans, record.depends)) {
+                Push(record);
+            }
+            consumed = pos - begin;
+            if (eof && consumed < filled) {
+                std::cerr << "Truncated binary trace" << std::endl;
+                AbruptExit(__FILE__, __LINE__);
+            }
+        } else {
+            if (eof && filled > 0 && buf[filled - 1] != '\n') {
+                buf[filled++] = '\n';
+            }
+            while (consumed < filled) {
+                const char* line = buf.data() + consumed;
+                const char* newline = static_cast<const char*>(
+                    memchr(line, '\n', filled - consumed));
+                if (newline == nullptr) {
+                    break;
+                }
+                if (ParseTextRecord(line, record.trans, record.depends)) {
+                    Push(record);
+                }
+                consumed = newline + 1 - buf.data();
+            }
+        }
+        if (eof) {
+            break;
+        }
+
+        // carry a cut off record over to the next chunk
+        filled -= consumed;
+        memmove(buf.data(), buf.data() + consumed, filled);
+        if (filled + 1 == buf.size()) {
+            buf.resize(buf.size() * 2);
+        }
+    }
+    done_.store(true, std::memory_order_release);
+}
+
+class TraceFanout::FanoutReader : public TraceReader {
+   public:
+    FanoutReader(TraceFanout& fanout, size_t index)
+        : fanout_(fanout), index_(index), next_chunk_(0), pos_(0) {}
+    using TraceReader::Next;
+    bool Next(Transaction& trans, bool& depends) override {
+        if (!chunk_ || pos_ == chunk_->size()) {
+            // an empty chunk marks the end
+            if (chunk_ && chunk_->empty()) {
+                return false;
+            }
+            chunk_ = fanout_.GetChunk(index_, next_chunk_++);
+            pos_ = 0;
+            if (chunk_->empty()) {
+                return false;
+            }
+        }
+        const Record& record = (*chunk_)[pos_++];
+        trans = record.trans;
+        depends = record.depends;
+        return true;
+    }
+
+   private:
+    TraceFanout& fanout_;
+    size_t index_;
+    uint64_t next_chunk_;
+    std::shared_ptr<const Chunk> chunk_;
+    size_t pos_;
+};
+
+TraceFanout::TraceFanout(std::unique_ptr<TraceReader> trace,
+                         size_t num_readers, size_t max_chunks)
+    : trace_(std::move(trace)),
+      max_chunks_(max_chunks),
+      done_(false),
+      first_chunk_(0),
+      reader_chunks_(num_readers, 0) {}
+
+std::unique_ptr<TraceReader> TraceFanout::Reader(size_t index) {
+    return std::unique_ptr<TraceReader>(new FanoutReader(*this, index));
+}
+
+void TraceFanout::Release(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reader_chunks_[index] = std::numeric_limits<uint64_t>::max();
+    FreeChunks();
+}
+
+void TraceFanout::FreeChunks() {
+    uint64_t slowest =
+        *std::min_element(reader_chunks_.begin(), reader_chunks_.end());
+    bool freed = false;
+    while (first_chunk_ < slowest && !chunks_.empty()) {
+        chunks_.pop_front();
+        first_chunk_++;
+        freed = true;
+    }
+    if (freed) {
+        advanced_.notify_all();
+    }
+}
+
+std::shared_ptr<const TraceFanout::Chunk> TraceFanout::GetChunk(
+    size_t reader, uint64_t chunk) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    reader_chunks_[reader] = chunk;
+    FreeChunks();
+
+    // the slowest reader never waits here, so neither do the others forever
+    while (max_chunks_ > 0 && !done_ &&
+           chunk == first_chunk_ + chunks_.size() &&
+           chunks_.size() >= max_chunks_) {
+        advanced_.wait(lock);
+    }
+    if (chunk == first_chunk_ + chunks_.size() && !done_) {
+        std::shared_ptr<Chunk> next(new Chunk());
+        next->reserve(kFanoutChunkSize);
+        Record record;
+        while (next->size() < kFanoutChunkSize &&
+               trace_->Next(record.trans, record.depends)) {
+            next->push_back(record);
+        }
+        done_ = next->size() < kFanoutChunkSize;
+        if (!next->empty()) {
+            chunks_.push_back(next);
+        }
+    }
+    if (chunk >= first_chunk_ + chunks_.size()) {
+        return std::make_shared<const Chunk>();
+    }
+    return chunks_[chunk - first_chunk_];
+}
+
+BinaryTraceWriter::BinaryTraceWriter(std::ostream& os)
+    : os_(os), last_cycle_(0), last_addr_(0) {
+    char header[kTraceHeaderSize];
+    memcpy(header, kTraceMagic, kTraceMagicSize);
+    PutUint32(header + kTraceMagicSize, kTraceVersion);
+    PutUint32(header + kTraceMagicSize + 4, 0);
+    os_.write(header, kTraceHeaderSize);
+}
+
+void BinaryTraceWriter::Write(const Transaction& trans, bool depends) {
+    uint64_t cycle_delta = ZigZag(trans.added_cycle - last_cycle_);
+    PutVarint(os_, (cycle_delta << 2) | (depends ? 2 : 0) |
+                       (trans.is_write ? 1 : 0));
+    PutVarint(os_, ZigZag(trans.addr - last_addr_));
+    last_cycle_ = trans.added_cycle;
+    last_addr_ = trans.addr;
+}
+
+bool IsBinaryTrace(const std::string& trace_file) {
+    char magic[kTraceMagicSize];
+    std::ifstream file(trace_file, std::ios::binary);
+    return file.read(magic, kTraceMagicSize) &&
+           memcmp(magic, kTraceMagic, kTraceMagicSize) == 0;
+}
+
+TraceCompression GetTraceCompression(const std::string& trace_file) {
+    unsigned char magic[4];
+    std::ifstream file(trace_file, std::ios::binary);
+    if (!file.read(reinterpret_cast<char*>(magic), 4)) {
+        return TraceCompression::NONE;
+    }
+    if (magic[0] == 0x1f && magic[1] == 0x8b) {
+        return TraceCompression::GZIP;
+    }
+    if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f &&
+        magic[3] == 0xfd) {
+        return TraceCompression::ZSTD;
+    }
+    return TraceCompression::NONE;
+}
+
+std::unique_ptr<TraceReader> OpenTraceReader(const std::string& trace_file) {
+    TraceCompression compression = GetTraceCompression(trace_file);
+    if (compression != TraceCompression::NONE) {
+        return std::unique_ptr<TraceReader>(
+            new StreamingTraceReader(trace_file, compression));
+    }
+    if (IsBinaryTrace(trace_file)) {
+        return std::unique_ptr<TraceReader>(new BinaryTraceReader(trace_file));
+    }
+    return std::unique_ptr<TraceReader>(new TextTraceReader(trace_file));
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,176 @@
+#ifndef __TRACE_READER_H
+#define __TRACE_READER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common.h"
+#include "spsc_ring.h"
+
+namespace dramsim3 {
+
+// Text traces have one "addr op cycle [DEP]" line per transaction. DEP marks
+// a transaction that must not issue before all earlier reads of the trace
+// have returned, which only closed loop replay looks at.
+//
+// Binary trace format, little endian:
+//   header: 8 byte magic "DS3TRACE", uint32 version, uint32 reserved (0)
+//   records: two LEB128 varints per transaction
+//     zigzag(added_cycle - previous added_cycle) << 2 | depends << 1 | is_write
+//     zigzag(addr - previous addr)
+// previous values start at 0. Sorted traces with local addresses take 2-5
+// bytes per transaction instead of ~25 in the text format. Version 1 has no
+// depends bit, the cycle delta is only shifted by 1.
+const char kTraceMagic[] = "DS3TRACE";
+const size_t kTraceMagicSize = 8;
+const uint32_t kTraceVersion = 2;
+const size_t kTraceHeaderSize = 16;
+
+// A source of trace transactions in file order
+class TraceReader {
+   public:
+    virtual ~TraceReader() {}
+    // fill addr, is_write and added_cycle of trans and whether it carries a
+    // DEP marker, false at the end of the trace
+    virtual bool Next(Transaction& trans, bool& depends) = 0;
+    bool Next(Transaction& trans) {
+        bool depends;
+        return Next(trans, depends);
+    }
+};
+
+// "addr op cycle" lines as read by operator>>(istream&, Transaction&)
+class TextTraceReader : public TraceReader {
+   public:
+    TextTraceReader(const std::string& trace_file);
+    using TraceReader::Next;
+    bool Next(Transaction& trans, bool& depends) override;
+
+   private:
+    std::ifstream trace_file_;
+    std::string line_;
+};
+
+// Decodes a binary trace straight out of a read-only memory mapping of the
+// file, no read() calls or copies in between
+class BinaryTraceReader : public TraceReader {
+   public:
+    BinaryTraceReader(const std::string& trace_file);
+    ~BinaryTraceReader();
+    using TraceReader::Next;
+    bool Next(Transaction& trans, bool& depends) override;
+
+   private:
+    void* map_;
+    size_t map_size_;
+    const uint8_t* pos_;
+    const uint8_t* end_;
+    uint64_t last_cycle_;
+    uint64_t last_addr_;
+    int flag_bits_;
+};
+
+enum class TraceCompression { NONE, GZIP, ZSTD };
+
+// Decompresses a chunk at a time, defined in trace_reader.cc
+class TraceDecompressor;
+
+// Streams a gzip or zstd compressed trace, text or binary, without
+// decompressing it to disk. A decode thread decompresses and parses ahead of
+// the simulation and hands transactions over through a lock-free ring, so
+// Next() only waits when the decoder falls behind.
+class StreamingTraceReader : public TraceReader {
+   public:
+    StreamingTraceReader(const std::string& trace_file,
+                         TraceCompression compression);
+    ~StreamingTraceReader();
+    using TraceReader::Next;
+    bool Next(Transaction& trans, bool& depends) override;
+
+   private:
+    struct Record {
+        Transaction trans;
+        bool depends;
+    };
+
+    std::unique_ptr<TraceDecompressor> source_;
+    SpscRing<Record> ring_;
+    std::atomic<bool> done_;
+    std::atomic<bool> stop_;
+    std::thread decoder_;
+
+    void DecodeLoop();
+    void Push(const Record& record);
+};
+
+// Reads a trace once for several readers that each go through all of it at
+// their own pace, e.g. one per memory system of a config sweep. Records are
+// decoded a chunk at a time and a chunk is freed once every reader has moved
+// past it. Readers may be on different threads. With max_chunks > 0 a reader
+// that gets that many chunks ahead of the slowest one waits for it, which
+// bounds memory as long as every reader keeps going on a thread of its own.
+class TraceFanout {
+   public:
+    TraceFanout(std::unique_ptr<TraceReader> trace, size_t num_readers,
+                size_t max_chunks = 0);
+    // reader index of num_readers, must not outlive the fanout
+    std::unique_ptr<TraceReader> Reader(size_t index);
+    // reader index is not going to read any more, nothing waits for it
+    void Release(size_t index);
+
+   private:
+    struct Record {
+        Transaction trans;
+        bool depends;
+    };
+    using Chunk = std::vector<Record>;
+    class FanoutReader;
+
+    std::unique_ptr<TraceReader> trace_;
+    size_t max_chunks_;
+    bool done_;
+
+    std::mutex mutex_;
+    std::condition_variable advanced_;
+    // chunks from first_chunk_ on that some reader still needs
+    std::deque<std::shared_ptr<const Chunk>> chunks_;
+    uint64_t first_chunk_;
+    // the chunk each reader is on
+    std::vector<uint64_t> reader_chunks_;
+
+    // chunk for reader, an empty one past the end of the trace
+    std::shared_ptr<const Chunk> GetChunk(size_t reader, uint64_t chunk);
+    // free the chunks all readers are past, mutex_ held
+    void FreeChunks();
+};
+
+class BinaryTraceWriter {
+   public:
+    // writes the header right away
+    BinaryTraceWriter(std::ostream& os);
+    void Write(const Transaction& trans, bool depends = false);
+
+   private:
+    std::ostream& os_;
+    uint64_t last_cycle_;
+    uint64_t last_addr_;
+};
+
+bool IsBinaryTrace(const std::string& trace_file);
+
+TraceCompression GetTraceCompression(const std::string& trace_file);
+
+// Open a reader for trace_file, telling compressed, binary and text traces
+// apart by their magic numbers
+std::unique_ptr<TraceReader> OpenTraceReader(const std::string& trace_file);
+
+}  // namespace dramsim3
+#endif
@@ -0,0 +1,236 @@
+#include "transaction_table.h"
+
+namespace dramsim3 {
+
+TransactionTable::TransactionTable(size_t expected_size)
+    : mask_(0), num_keys_(0), free_slot_(-1), size_(0) {
+    // keep the load factor at or below 1/2
+    size_t num_buckets = 16;
+    while (num_buckets < 2 * expected_size) {
+        num_buckets *= 2;
+    }
+    Rehash(num_buckets);
+    slots_.reserve(expected_size);
+}
+
+size_t TransactionTable::Count(uint64_t addr) const {
+    int b = FindBucket(addr);
+    return b < 0 ? 0 : buckets_[b].count;
+}
+
+size_t TransactionTable::Insert(const Transaction& trans) {
+    int slot = AllocSlot(trans);
+    size_ += 1;
+    int b = FindBucket(trans.addr);
+    if (b >= 0) {
+        auto& bucket = buckets_[b];
+        slots_[bucket.tail].next = slot;
+        bucket.tail = slot;
+        bucket.count += 1;
+        return bucket.count;
+    }
+
+    if (2 * (num_keys_ + 1) > buckets_.size()) {
+        Rehash(2 * buckets_.size());
+    }
+    size_t i = Home(trans.addr);
+    while (buckets_[i].head >= 0) {
+        i = (i + 1) & mask_;
+    }
+    buckets_[i].addr = trans.addr;
+    buckets_[i].head = slot;
+    buckets_[i].tail = slot;
+    buckets_[i].count = 1;
+    num_keys_ += 1;
+    return 1;
+}
+
+Transaction* TransactionTable::Front(uint64_t addr) {
+    int b = FindBucket(addr);
+    return b < 0 ? nullptr : &slots_[buckets_[b].head].trans;
+}
+
+void TransactionTable::PopFront(uint64_t addr) {
+    int b = FindBucket(addr);
+    if (b < 0) {
+        return;
+    }
+    auto& bucket = buckets_[b];
+    int slot = bucket.head;
+    bucket.head = slots_[slot].next;
+    bucket.count -= 1;
+    FreeSlot(slot);
+    size_ -= 1;
+    if (bucket.count == 0) {
+        EraseBucket(b);
+    }
+}
+
+int TransactionTable::FindBucket(uint64_t addr) const {
+    size_t i = Home(addr);
+    while (buckets_[i].head >= 0) {
+        if (buckets_[i].addr == addr) {
+            return static_cast<int>(i);
+        }
+        i = (i + 1) & mask_;
+    }
+    return -1;
+}
+
+void TransactionTable::EraseBucket(int b) {
+    // backward shift deletion so that lookups never need tombstones: move
+    // later entries of the probe run into the hole unless that would put
+    // them in front of their home bucket
+    size_t hole = static_cast<size_t>(b);
+    size_t i = hole;
+    while (true) {
+        i = (i + 1) & mask_;
+        if (buckets_[i].head < 0) {
+            break;
+        }
+        size_t home = Home(buckets_[i].addr);
+        bool home_in_range = hole <= i ? (hole < home && home <= i)
+                                       : (hole < home || home <= i);
+        if (!home_in_range) {
+            buckets_[hole] = buckets_[i];
+            hole = i;
+        }
+    }
+    buckets_[hole].head = -1;
+    num_keys_ -= 1;
+}
+
+void TransactionTable::Rehash(size_t num_buckets) {
+    std::vector<Bucket> old_buckets;
+    old_buckets.swap(buckets_);
+    buckets_.resize(num_buckets);
+    for (auto& bucket : buckets_) {
+        bucket.head = -1;
+    }
+    mask_ = num_buckets - 1;
+    for (const auto& bucket : old_buckets) {
+        if (bucket.head < 0) {
+            continue;
+        }
+        size_t i = Home(bucket.addr);
+        while (buckets_[i].head >= 0) {
+            i = (i + 1) & mask_;
+        }
+        buckets_[i] = bucket;
+    }
+}
+
+int TransactionTable::AllocSlot(const Transaction& trans) {
+    int slot = free_slot_;
+    if (slot >= 0) {
+        free_slot_ = slots_[slot].next;
+        slots_[slot].trans = trans;
+    } else {
+        slot = static_cast<int>(slots_.size());
+        slots_.push_back(Slot{trans, -1});
+    }
+    slots_[slot].next = -1;
+    return slot;
+}
+
+void TransactionTable::SaveState(CheckpointWriter& ckpt) const {
+    ckpt.Put(static_cast<uint64_t>(buckets_.size()));
+    for (const auto& bucket : buckets_) {
+        ckpt.Put(bucket.addr);
+        ckpt.Put(bucket.head);
+        ckpt.Put(bucket.tail);
+        ckpt.Put(bucket.count);
+    }
+    ckpt.Put(static_cast<uint64_t>(num_keys_));
+    ckpt.Put(static_cast<uint64_t>(slots_.size()));
+    for (const auto& slot : slots_) {
+        ckpt.Put(slot.trans);
+        ckpt.Put(slot.next);
+    }
+    ckpt.Put(free_slot_);
+    ckpt.Put(static_cast<uint64_t>(size_));
+}
+
+void TransactionTable::RestoreState(CheckpointReader& ckpt) {
+    uint64_t num_buckets = ckpt.GetSize();
+    // mask_ needs a power of 2
+    if (num_buckets == 0 || (num_buckets & (num_buckets - 1)) != 0) {
+        ckpt.Fail();
+        return;
+    }
+    buckets_.resize(num_buckets);
+    mask_ = num_buckets - 1;
+    for (auto& bucket : buckets_) {
+        ckpt.Get(bucket.addr);
+        ckpt.Get(bucket.head);
+        ckpt.Get(bucket.tail);
+        ckpt.Get(bucket.count);
+    }
+    uint64_t num_keys;
+    ckpt.Get(num_keys);
+    num_keys_ = num_keys;
+    slots_.resize(ckpt.GetSize());
+    for (auto& slot : slots_) {
+        ckpt.Get(slot.trans);
+        ckpt.Get(slot.next);
+    }
+    ckpt.Get(free_slot_);
+    uint64_t size;
+    ckpt.Get(size);
+    size_ = size;
+    if (!ckpt.Ok() || !Consistent()) {
+        ckpt.Fail();
+        // empty but usable
+        for (auto& bucket : buckets_) {
+            bucket.head = -1;
+        }
+        num_keys_ = 0;
+        slots_.clear();
+        free_slot_ = -1;
+        size_ = 0;
+    }
+}
+
+bool TransactionTable::Consistent() const {
+    // every list must stay within slots_, end at its tail after count slots
+    // and not share a slot with another list or the free list
+    int num_slots = static_cast<int>(slots_.size());
+    std::vector<bool> used(slots_.size(), false);
+    auto take = [&](int slot) {
+        if (slot < 0 || slot >= num_slots || used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+        return true;
+    };
+    size_t num_keys = 0;
+    size_t size = 0;
+    for (const auto& bucket : buckets_) {
+        if (bucket.head < 0) {
+            continue;
+        }
+        int slot = bucket.head;
+        for (uint32_t i = 1; i < bucket.count; i++) {
+            if (!take(slot)) {
+                return false;
+            }
+            slot = slots_[slot].next;
+        }
+        if (bucket.count == 0 || slot != bucket.tail || !take(slot) ||
+            slots_[slot].next != -1) {
+            return false;
+        }
+        num_keys += 1;
+        size += bucket.count;
+    }
+    for (int slot = free_slot_; slot != -1; slot = slots_[slot].next) {
+        if (!take(slot)) {
+            return false;
+        }
+    }
+    // lookups need at least one empty bucket to stop at
+    return num_keys == num_keys_ && size == size_ &&
+           num_keys_ < buckets_.size();
+}
+
+}  // namespace dramsim3
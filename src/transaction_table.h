@@ -0,0 +1,107 @@
+#ifndef __TRANSACTION_TABLE_H
+#define __TRANSACTION_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "checkpoint.h"
+#include "common.h"
+
+namespace dramsim3 {
+
+// Pending transactions keyed by address, a replacement for
+// std::multimap<uint64_t, Transaction> that does not allocate per insert.
+// Addresses live in an open addressing (linear probing) hash table whose
+// entries point at a FIFO list of transactions in a pooled slot array, so
+// transactions to the same address come back out in the order they went in
+// and coalesced reads / write lookups are a single probe.
+class TransactionTable {
+   public:
+    TransactionTable(size_t expected_size);
+
+    bool Contains(uint64_t addr) const { return FindBucket(addr) >= 0; }
+    size_t Count(uint64_t addr) const;
+    size_t Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+
+    // append trans behind the ones with the same address, returns how many
+    // transactions to that address are pending including trans
+    size_t Insert(const Transaction& trans);
+
+    // oldest transaction to addr, nullptr if there is none
+    Transaction* Front(uint64_t addr);
+    void PopFront(uint64_t addr);
+
+    // remove all transactions to addr oldest first, calling f on each,
+    // returns how many were removed
+    template <typename F>
+    size_t Drain(uint64_t addr, F f) {
+        int b = FindBucket(addr);
+        if (b < 0) {
+            return 0;
+        }
+        size_t count = buckets_[b].count;
+        int slot = buckets_[b].head;
+        while (slot >= 0) {
+            int next = slots_[slot].next;
+            f(slots_[slot].trans);
+            FreeSlot(slot);
+            slot = next;
+        }
+        size_ -= count;
+        EraseBucket(b);
+        return count;
+    }
+
+    // call f on every pending transaction, in no particular order
+    template <typename F>
+    void ForEach(F f) {
+        for (const auto& bucket : buckets_) {
+            for (int slot = bucket.head; slot >= 0; slot = slots_[slot].next) {
+                f(slots_[slot].trans);
+            }
+        }
+    }
+
+    // the table as is, buckets, slots and free list included
+    void SaveState(CheckpointWriter& ckpt) const;
+    void RestoreState(CheckpointReader& ckpt);
+
+   private:
+    struct Bucket {
+        uint64_t addr;
+        int head;  // -1 if the bucket is empty
+        int tail;
+        uint32_t count;
+    };
+    struct Slot {
+        Transaction trans;
+        int next;  // next slot of the same address or the free list
+    };
+
+    std::vector<Bucket> buckets_;
+    size_t mask_;
+    size_t num_keys_;
+    std::vector<Slot> slots_;
+    int free_slot_;
+    size_t size_;
+
+    size_t Home(uint64_t addr) const {
+        // fibonacci hashing, addresses often only differ in a few middle bits
+        return static_cast<size_t>((addr * 0x9E3779B97F4A7C15ull) >> 32) &
+               mask_;
+    }
+    int FindBucket(uint64_t addr) const;
+    // whether restored buckets, lists and counts fit together
+    bool Consistent() const;
+    void EraseBucket(int b);
+    void Rehash(size_t num_buckets);
+    int AllocSlot(const Transaction& trans);
+    void FreeSlot(int slot) {
+        slots_[slot].next = free_slot_;
+        free_slot_ = slot;
+    }
+};
+
+}  // namespace dramsim3
+#endif
@@ -0,0 +1,105 @@
+#include "worker_pool.h"
+
+namespace dramsim3 {
+
+namespace {
+// number of polls before a waiting thread yields its core, and of yields
+// before it goes to sleep
+const int kSpinsBeforeYield = 2048;
+const int kYieldsBeforeSleep = 64;
+}  // namespace
+
+WorkerPool::WorkerPool(int num_threads)
+    : num_threads_(num_threads < 1 ? 1 : num_threads),
+      task_(nullptr),
+      num_tasks_(0),
+      generation_(0),
+      num_busy_(0),
+      stop_(false),
+      num_sleeping_(0) {
+    threads_.reserve(num_threads_ - 1);
+    for (int i = 1; i < num_threads_; i++) {
+        threads_.emplace_back(&WorkerPool::WorkerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    stop_.store(true, std::memory_order_relaxed);
+    generation_.fetch_add(1);
+    Wake();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkerPool::Run(size_t num_tasks,
+                     const std::function<void(size_t)>& task) {
+    if (num_threads_ == 1) {
+        for (size_t i = 0; i < num_tasks; i++) {
+            task(i);
+        }
+        return;
+    }
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    num_busy_.store(num_threads_ - 1, std::memory_order_relaxed);
+    generation_.fetch_add(1);
+    Wake();
+    RunShare(0);
+    Wait([this] { return num_busy_.load() == 0; });
+    task_ = nullptr;
+}
+
+template <typename Pred>
+void WorkerPool::Wait(Pred done) {
+    for (int spins = 0; spins < kSpinsBeforeYield; spins++) {
+        if (done()) {
+            return;
+        }
+    }
+    for (int yields = 0; yields < kYieldsBeforeSleep; yields++) {
+        if (done()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+    // a waker changes the state before it checks for sleepers and we
+    // register before checking the state (all sequentially consistent), so
+    // one of the two sees the other
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    num_sleeping_.fetch_add(1);
+    sleep_cv_.wait(lock, done);
+    num_sleeping_.fetch_sub(1);
+}
+
+void WorkerPool::Wake() {
+    if (num_sleeping_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.notify_all();
+    }
+}
+
+void WorkerPool::WorkerLoop(int thread_id) {
+    uint64_t seen_generation = 0;
+    while (true) {
+        Wait([this, seen_generation] {
+            return generation_.load() != seen_generation;
+        });
+        seen_generation = generation_.load(std::memory_order_acquire);
+        if (stop_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        RunShare(thread_id);
+        if (num_busy_.fetch_sub(1) == 1) {
+            Wake();
+        }
+    }
+}
+
+void WorkerPool::RunShare(int thread_id) {
+    for (size_t i = thread_id; i < num_tasks_; i += num_threads_) {
+        (*task_)(i);
+    }
+}
+
+}  // namespace dramsim3
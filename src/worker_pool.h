@@ -0,0 +1,52 @@
+#ifndef __WORKER_POOL_H
+#define __WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dramsim3 {
+
+// A persistent pool of threads that runs a batch of independent tasks and
+// waits for all of them (i.e. a barrier) on every Run() call. Meant for short
+// per cycle work such as ticking channels, so waiting threads spin briefly
+// and only then sleep on a condition variable, e.g. while a host simulator
+// runs between ticks.
+class WorkerPool {
+   public:
+    // num_threads includes the calling thread, 1 means no worker threads
+    WorkerPool(int num_threads);
+    ~WorkerPool();
+    // Run task(i) for each i in [0, num_tasks). Task i always runs on thread
+    // i % num_threads so the same channel stays on the same core, the calling
+    // thread takes part as thread 0.
+    void Run(size_t num_tasks, const std::function<void(size_t)>& task);
+    int NumThreads() const { return num_threads_; }
+
+   private:
+    int num_threads_;
+    std::vector<std::thread> threads_;
+
+    const std::function<void(size_t)>* task_;
+    size_t num_tasks_;
+    std::atomic<uint64_t> generation_;
+    std::atomic<int> num_busy_;
+    std::atomic<bool> stop_;
+
+    // threads that gave up spinning wait here for a new batch or its end
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<int> num_sleeping_;
+
+    template <typename Pred>
+    void Wait(Pred done);
+    void Wake();
+    void WorkerLoop(int thread_id);
+    void RunShare(int thread_id);
+};
+
+}  // namespace dramsim3
+#endif
@@ -0,0 +1,56 @@
+#ifndef __BURST_TRAFFIC_H
+#define __BURST_TRAFFIC_H
+
+#include <algorithm>
+#include <cstdint>
+
+// Bursts of requests separated by idle periods long enough to span
+// refreshes, mostly reads, and every eighth request going back to one
+// address so that reads wait behind writes. The tests that compare two ways
+// of simulating the same traffic all use this.
+class BurstTraffic {
+   public:
+    static const uint64_t kPeriod = 3000;
+    static const uint64_t kBurstCycles = 600;
+
+    static bool InBurst(uint64_t clk) { return clk % kPeriod < kBurstCycles; }
+    static uint64_t NextBurst(uint64_t clk) {
+        return (clk / kPeriod + 1) * kPeriod;
+    }
+
+    // the request of the next burst cycle, whether it is accepted or not
+    void Next(uint64_t &addr, bool &is_write) {
+        rand_ = rand_ * 6364136223846793005 + 1442695040888963407;
+        is_write = (rand_ >> 60) < 5;
+        addr = (rand_ >> 10) % 8 == 0 ? 0x1000 : rand_ >> 20;
+    }
+
+   private:
+    uint64_t rand_ = 0;
+};
+
+// Offer sys the requests of cycles [from, to), tagged with their cycle, and
+// move it on with tick(clk, target), which returns the new cycle. The target
+// is the next cycle during bursts and the next burst (or to) otherwise. A
+// run can be cut anywhere and picked up with the same traffic.
+template <typename System, typename Tick>
+void DriveBursts(System &sys, BurstTraffic &traffic, uint64_t from,
+                 uint64_t to, Tick tick) {
+    uint64_t clk = from;
+    while (clk < to) {
+        uint64_t target = clk + 1;
+        if (BurstTraffic::InBurst(clk)) {
+            uint64_t addr;
+            bool is_write;
+            traffic.Next(addr, is_write);
+            if (sys.WillAcceptTransaction(addr, is_write)) {
+                sys.AddTransaction(addr, is_write, clk);
+            }
+        } else {
+            target = std::min(to, BurstTraffic::NextBurst(clk));
+        }
+        clk = tick(clk, target);
+    }
+}
+
+#endif
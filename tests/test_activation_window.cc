@@ -0,0 +1,43 @@
+#include <random>
+#include <vector>
+#include "activation_window.h"
+#include "catch.hpp"
+
+TEST_CASE("Activation window Testing", "[activation]") {
+    SECTION("tFAW budget") {
+        dramsim3::ActivationWindow faw(4, 20);
+        for (uint64_t clk = 0; clk < 4; clk++) {
+            REQUIRE(faw.IsReady(clk));
+            faw.Record(clk);
+        }
+        REQUIRE(!faw.IsReady(4));
+        REQUIRE(!faw.IsReady(19));
+        REQUIRE(faw.ReadyCycle() == 20);
+        REQUIRE(faw.IsReady(20));
+        faw.Record(20);
+        REQUIRE(faw.ReadyCycle() == 21);
+    }
+
+    SECTION("Matches the vector model") {
+        // the previous implementation: a vector that retires at most its
+        // oldest expired entry per activation
+        std::mt19937_64 gen(7);
+        dramsim3::ActivationWindow window(32, 100);
+        std::vector<uint64_t> model;
+        uint64_t clk = 0;
+        for (int i = 0; i < 100000; i++) {
+            clk += gen() % 8;
+            bool model_ready = model.size() < 32 || clk >= model.front();
+            REQUIRE(window.IsReady(clk) == model_ready);
+            REQUIRE(window.ReadyCycle() ==
+                    (model.size() >= 32 ? model.front() : 0));
+            if (model_ready) {
+                if (!model.empty() && clk >= model.front()) {
+                    model.erase(model.begin());
+                }
+                model.push_back(clk + 100);
+                window.Record(clk);
+            }
+        }
+    }
+}
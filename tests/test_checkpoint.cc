@@ -0,0 +1,205 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "burst_traffic.h"
+#include "catch.hpp"
+#include "configuration.h"
+#include "dram_system.h"
+#include "memory_system.h"
+
+namespace {
+
+// (cycle, address, tag) of every completion
+using Returns = std::vector<std::tuple<uint64_t, uint64_t, uint64_t>>;
+
+// the burst traffic ticked through cycle by cycle, a run can be cut anywhere
+// and picked up again with the same traffic
+template <typename System>
+void Drive(System &sys, BurstTraffic &traffic, uint64_t from, uint64_t to,
+           Returns &returns) {
+    uint64_t clk = from;
+    auto callback = [&](uint64_t addr, uint64_t tag) {
+        returns.emplace_back(clk, addr, tag);
+    };
+    sys.RegisterTaggedCallbacks(callback, callback);
+    DriveBursts(sys, traffic, from, to, [&](uint64_t now, uint64_t) {
+        clk = now;
+        sys.ClockTick();
+        return now + 1;
+    });
+}
+
+std::string ReadFile(const std::string &file) {
+    std::ifstream in(file, std::ifstream::binary);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+}
+
+// run [0, end) in one go and [0, cut) + restored [cut, end), the two must
+// complete the same transactions in the same cycles and end up in the same
+// state
+void CheckRestore(dramsim3::Config &save_config,
+                  dramsim3::Config &restore_config, uint64_t cut,
+                  uint64_t end) {
+    Returns full_returns, cut_returns;
+    BurstTraffic full_traffic, cut_traffic;
+    dramsim3::JedecDRAMSystem full(restore_config, ".", nullptr, nullptr);
+    Drive(full, full_traffic, 0, end, full_returns);
+    REQUIRE(!full_returns.empty());
+
+    {
+        dramsim3::JedecDRAMSystem first(save_config, ".", nullptr, nullptr);
+        Drive(first, cut_traffic, 0, cut, cut_returns);
+        REQUIRE(first.SaveCheckpoint("test_ckpt_cut.bin"));
+    }
+    dramsim3::JedecDRAMSystem second(restore_config, ".", nullptr, nullptr);
+    REQUIRE(second.RestoreCheckpoint("test_ckpt_cut.bin"));
+    REQUIRE(second.GetClk() == cut);
+    Drive(second, cut_traffic, cut, end, cut_returns);
+    REQUIRE(cut_returns == full_returns);
+
+    REQUIRE(full.SaveCheckpoint("test_ckpt_full.bin"));
+    REQUIRE(second.SaveCheckpoint("test_ckpt_second.bin"));
+    REQUIRE(ReadFile("test_ckpt_full.bin") ==
+            ReadFile("test_ckpt_second.bin"));
+    std::remove("test_ckpt_cut.bin");
+    std::remove("test_ckpt_full.bin");
+    std::remove("test_ckpt_second.bin");
+}
+
+}  // namespace
+
+TEST_CASE("Checkpoint restore Testing", "[dramsim3][checkpoint]") {
+    SECTION("TEST HBM mid burst") {
+        dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+        CheckRestore(config, config, 3300, 12000);
+    }
+
+    SECTION("TEST DDR4 across refreshes") {
+        dramsim3::Config config("configs/DDR4_8Gb_x8_2400.ini", ".");
+        CheckRestore(config, config, 6400, 20000);
+    }
+
+    SECTION("TEST GDDR5 activation windows") {
+        dramsim3::Config config("configs/GDDR5_8Gb_x32.ini", ".");
+        CheckRestore(config, config, 3500, 12000);
+    }
+
+    SECTION("TEST between event driven and cycle by cycle mode") {
+        dramsim3::Config cycle_config("configs/HBM1_4Gb_x128.ini", ".");
+        dramsim3::Config event_config("configs/HBM1_4Gb_x128.ini", ".");
+        event_config.event_driven = true;
+        CheckRestore(event_config, event_config, 3300, 12000);
+        CheckRestore(cycle_config, event_config, 3300, 12000);
+        CheckRestore(event_config, cycle_config, 4200, 12000);
+    }
+}
+
+TEST_CASE("Checkpoint restore with other timings Testing",
+          "[dramsim3][checkpoint]") {
+    // same organization, other speed bin: what was queued carries over and
+    // everything after the cut runs with the new timings
+    const uint64_t cut = 3300;
+    dramsim3::Config config_2400("configs/DDR4_8Gb_x8_2400.ini", ".");
+    dramsim3::Config config_3200("configs/DDR4_8Gb_x8_3200.ini", ".");
+    Returns before_cut;
+    BurstTraffic traffic;
+    {
+        dramsim3::JedecDRAMSystem first(config_2400, ".", nullptr, nullptr);
+        Drive(first, traffic, 0, cut, before_cut);
+        REQUIRE(first.SaveCheckpoint("test_ckpt_timing.bin"));
+    }
+
+    // total latency of the transactions added after the cut
+    auto continue_with = [&](dramsim3::Config &config) {
+        dramsim3::JedecDRAMSystem second(config, ".", nullptr, nullptr);
+        REQUIRE(second.RestoreCheckpoint("test_ckpt_timing.bin"));
+        REQUIRE(second.GetClk() == cut);
+        Returns returns = before_cut;
+        BurstTraffic same_traffic = traffic;
+        Drive(second, same_traffic, cut, 8000, returns);
+        REQUIRE(returns.size() > before_cut.size());
+        std::set<uint64_t> tags;
+        uint64_t latency = 0;
+        for (const auto &ret : returns) {
+            // nothing comes back twice
+            REQUIRE(tags.insert(std::get<2>(ret)).second);
+            if (std::get<2>(ret) >= cut) {
+                latency += std::get<0>(ret) - std::get<2>(ret);
+            }
+        }
+        return latency;
+    };
+    // the timings of the higher speed bin are longer in cycles
+    REQUIRE(continue_with(config_3200) > continue_with(config_2400));
+    std::remove("test_ckpt_timing.bin");
+}
+
+TEST_CASE("HMC checkpoint restore Testing", "[dramsim3][checkpoint][hmc]") {
+    const std::string config_file = "configs/HMC_2GB_4Lx16.ini";
+    Returns full_returns, cut_returns;
+    BurstTraffic full_traffic, cut_traffic;
+    dramsim3::MemorySystem full(config_file, ".", nullptr, nullptr);
+    Drive(full, full_traffic, 0, 5000, full_returns);
+    REQUIRE(!full_returns.empty());
+    {
+        dramsim3::MemorySystem first(config_file, ".", nullptr, nullptr);
+        Drive(first, cut_traffic, 0, 3100, cut_returns);
+        REQUIRE(first.SaveCheckpoint("test_ckpt_hmc.bin"));
+    }
+    dramsim3::MemorySystem second(config_file, ".", nullptr, nullptr);
+    REQUIRE(second.RestoreCheckpoint("test_ckpt_hmc.bin"));
+    Drive(second, cut_traffic, 3100, 5000, cut_returns);
+    REQUIRE(cut_returns == full_returns);
+    std::remove("test_ckpt_hmc.bin");
+}
+
+TEST_CASE("Checkpoint rejection Testing", "[dramsim3][checkpoint]") {
+    dramsim3::Config hbm_config("configs/HBM1_4Gb_x128.ini", ".");
+    dramsim3::JedecDRAMSystem hbm(hbm_config, ".", nullptr, nullptr);
+    REQUIRE(hbm.SaveCheckpoint("test_ckpt_hbm.bin"));
+
+    SECTION("TEST different organization") {
+        dramsim3::Config ddr4_config("configs/DDR4_8Gb_x8_2400.ini", ".");
+        dramsim3::JedecDRAMSystem ddr4(ddr4_config, ".", nullptr, nullptr);
+        REQUIRE(!ddr4.RestoreCheckpoint("test_ckpt_hbm.bin"));
+    }
+
+    SECTION("TEST queues too short for what was queued") {
+        dramsim3::Config config("configs/DDR4_8Gb_x8_2400.ini", ".");
+        Returns returns;
+        BurstTraffic traffic;
+        dramsim3::JedecDRAMSystem busy(config, ".", nullptr, nullptr);
+        Drive(busy, traffic, 0, 300, returns);
+        REQUIRE(busy.SaveCheckpoint("test_ckpt_busy.bin"));
+
+        dramsim3::Config short_trans_config("configs/DDR4_8Gb_x8_2400.ini",
+                                            ".");
+        short_trans_config.trans_queue_size = 2;
+        dramsim3::JedecDRAMSystem short_trans(short_trans_config, ".",
+                                              nullptr, nullptr);
+        REQUIRE(!short_trans.RestoreCheckpoint("test_ckpt_busy.bin"));
+
+        dramsim3::Config short_cmd_config("configs/DDR4_8Gb_x8_2400.ini",
+                                          ".");
+        short_cmd_config.cmd_queue_size = 1;
+        dramsim3::JedecDRAMSystem short_cmd(short_cmd_config, ".", nullptr,
+                                            nullptr);
+        REQUIRE(!short_cmd.RestoreCheckpoint("test_ckpt_busy.bin"));
+        std::remove("test_ckpt_busy.bin");
+    }
+
+    SECTION("TEST truncated and missing files") {
+        std::string snapshot = ReadFile("test_ckpt_hbm.bin");
+        std::ofstream("test_ckpt_short.bin", std::ofstream::binary)
+            << snapshot.substr(0, snapshot.size() / 2);
+        REQUIRE(!hbm.RestoreCheckpoint("test_ckpt_short.bin"));
+        REQUIRE(!hbm.RestoreCheckpoint("test_ckpt_missing.bin"));
+        std::remove("test_ckpt_short.bin");
+    }
+    std::remove("test_ckpt_hbm.bin");
+}
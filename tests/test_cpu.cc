@@ -0,0 +1,327 @@
+#include <sys/stat.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "catch.hpp"
+#include "cpu.h"
+
+namespace {
+
+const char kConfig[] = "configs/DDR4_8Gb_x8_2400.ini";
+
+// (CPU cycle, address) of every completion the CPU is handed
+using Returns = std::vector<std::pair<uint64_t, uint64_t>>;
+
+template <typename Base>
+class RecordingCPU : public Base {
+   public:
+    using Base::Base;
+    void Complete(const dramsim3::MemoryRequest *done,
+                  size_t count) override {
+        for (size_t i = 0; i < count; i++) {
+            returns.emplace_back(this->GetClk(), done[i].addr);
+        }
+        Base::Complete(done, count);
+    }
+
+    Returns returns;
+};
+
+void WriteTrace(const std::string &file, const std::string &lines) {
+    std::ofstream out(file);
+    out << lines;
+}
+
+template <typename CPUType>
+void Run(CPUType &cpu, uint64_t cycles) {
+    while (cpu.GetClk() < cycles && !cpu.Finished()) {
+        cpu.ClockTick();
+    }
+}
+
+std::string ReadFile(const std::string &file) {
+    std::ifstream in(file);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+}
+
+const char *const kStatsFiles[] = {"dramsim3.txt", "dramsim3.json"};
+
+void RemoveOutputs(const std::string &dir) {
+    for (const char *file : kStatsFiles) {
+        std::remove((dir + "/" + file).c_str());
+    }
+    std::remove((dir + "/dramsim3epoch.jsonl").c_str());
+    std::remove(dir.c_str());
+}
+
+}  // namespace
+
+TEST_CASE("Multi trace CPU Testing", "[cpu]") {
+    WriteTrace("test_cpu_a.trace",
+               "0x0 READ 0\n"
+               "0x100000 READ 2000\n"
+               "0x200000 READ 4000\n");
+    WriteTrace("test_cpu_b.trace",
+               "0x40 READ 1000\n"
+               "0x100040 READ 3000\n");
+    // four reads to one bank, all due at once
+    WriteTrace("test_cpu_c.trace",
+               "0x0 READ 0\n"
+               "0x40 READ 0\n"
+               "0x80 READ 0\n"
+               "0xC0 READ 0\n");
+    WriteTrace("test_cpu_d.trace", "0x0 READ 1\n");
+
+    SECTION("TEST merged on cycle with address offsets") {
+        RecordingCPU<dramsim3::MultiTraceCPU> cpu(
+            kConfig, ".",
+            {"test_cpu_a.trace", "test_cpu_b.trace,0,0x10000000"});
+        Run(cpu, 6000);
+        const std::vector<std::pair<uint64_t, uint64_t>> expected = {
+            {0, 0x0},
+            {1000, 0x10000040},
+            {2000, 0x100000},
+            {3000, 0x10100040},
+            {4000, 0x200000}};
+        REQUIRE(cpu.returns.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            // each one issues at its cycle and is done well before the next
+            REQUIRE(cpu.returns[i].second == expected[i].second);
+            REQUIRE(cpu.returns[i].first > expected[i].first);
+            REQUIRE(cpu.returns[i].first < expected[i].first + 1000);
+        }
+    }
+
+    SECTION("TEST outstanding limit holds a stream back") {
+        dramsim3::Config config(kConfig, ".");
+        uint64_t min_latency = config.CL;
+        RecordingCPU<dramsim3::MultiTraceCPU> open(kConfig, ".",
+                                                   {"test_cpu_c.trace"});
+        Run(open, 1000);
+        RecordingCPU<dramsim3::MultiTraceCPU> limited(
+            kConfig, ".",
+            {"test_cpu_c.trace,1", "test_cpu_d.trace,0,0x10000000"});
+        Run(limited, 1000);
+
+        // without a limit the reads overlap, with one each waits for the
+        // previous one to return
+        REQUIRE(open.returns.size() == 4);
+        REQUIRE(open.returns.back().first - open.returns.front().first <
+                3 * min_latency);
+        Returns limited_c;
+        for (const auto &ret : limited.returns) {
+            if (ret.second < 0x100) {
+                limited_c.push_back(ret);
+            }
+        }
+        REQUIRE(limited_c.size() == 4);
+        for (size_t i = 1; i < limited_c.size(); i++) {
+            REQUIRE(limited_c[i].first - limited_c[i - 1].first >=
+                    min_latency);
+        }
+        // the other stream is not held back
+        REQUIRE(limited.returns.size() == 5);
+        REQUIRE(limited.returns[1].second == 0x10000000);
+    }
+
+    std::remove("test_cpu_a.trace");
+    std::remove("test_cpu_b.trace");
+    std::remove("test_cpu_c.trace");
+    std::remove("test_cpu_d.trace");
+}
+
+TEST_CASE("Closed loop trace CPU Testing", "[cpu]") {
+    dramsim3::Config config(kConfig, ".");
+    uint64_t min_latency = config.CL;
+    // three reads to one row, the second waits for the first to return
+    WriteTrace("test_cpu_dep.trace",
+               "0x0 READ 0\n"
+               "0x40 READ 10 DEP\n"
+               "0x80 READ 20\n");
+    WriteTrace("test_cpu_nodep.trace",
+               "0x0 READ 0\n"
+               "0x40 READ 10\n"
+               "0x80 READ 20\n");
+
+    // completion cycle of each address
+    auto done_clks = [](const Returns &returns) {
+        std::map<uint64_t, uint64_t> clks;
+        for (const auto &ret : returns) {
+            clks[ret.second] = ret.first;
+        }
+        return clks;
+    };
+
+    SECTION("TEST DEP waits for earlier reads and pushes the rest back") {
+        RecordingCPU<dramsim3::TraceBasedCPU> cpu(kConfig, ".",
+                                                  "test_cpu_dep.trace", true);
+        Run(cpu, 1000);
+        auto clks = done_clks(cpu.returns);
+        REQUIRE(clks.size() == 3);
+        // the gap of 10 counts from the first read's return, the gap of the
+        // third one from the second one's issue
+        REQUIRE(clks[0x40] >= clks[0x0] + 10 + min_latency);
+        REQUIRE(clks[0x80] >= clks[0x0] + 20 + min_latency);
+    }
+
+    SECTION("TEST without DEP the gaps count from the issues") {
+        RecordingCPU<dramsim3::TraceBasedCPU> cpu(kConfig, ".",
+                                                  "test_cpu_nodep.trace", true);
+        Run(cpu, 1000);
+        auto clks = done_clks(cpu.returns);
+        REQUIRE(clks.size() == 3);
+        REQUIRE(clks[0x40] < clks[0x0] + 10);
+        REQUIRE(clks[0x80] < clks[0x0] + 20);
+    }
+
+    SECTION("TEST open loop ignores DEP") {
+        RecordingCPU<dramsim3::TraceBasedCPU> cpu(kConfig, ".",
+                                                  "test_cpu_dep.trace");
+        Run(cpu, 1000);
+        auto clks = done_clks(cpu.returns);
+        REQUIRE(clks.size() == 3);
+        REQUIRE(clks[0x40] < clks[0x0] + 10);
+    }
+
+    std::remove("test_cpu_dep.trace");
+    std::remove("test_cpu_nodep.trace");
+}
+
+TEST_CASE("CPU checkpoint restore Testing", "[cpu][checkpoint]") {
+    dramsim3::Config config(kConfig, ".");
+    uint64_t min_latency = config.CL;
+    WriteTrace("test_cpu_warm.trace",
+               "0x20000000 READ 0\n"
+               "0x20000040 READ 0\n"
+               "0x30000000 READ 0\n"
+               "0x30000040 READ 0\n");
+    WriteTrace("test_cpu_c.trace",
+               "0x0 READ 0\n"
+               "0x40 READ 0\n"
+               "0x80 READ 0\n"
+               "0xC0 READ 0\n");
+    // two streams with everything still in flight when saved
+    {
+        dramsim3::MultiTraceCPU warm(
+            kConfig, ".",
+            {"test_cpu_warm.trace", "test_cpu_warm.trace,0,0x1000000"});
+        Run(warm, 5);
+        REQUIRE(warm.SaveCheckpoint("test_cpu.ckpt"));
+    }
+
+    SECTION("TEST restored completions do not count for the new streams") {
+        RecordingCPU<dramsim3::MultiTraceCPU> cpu(kConfig, ".",
+                                                  {"test_cpu_c.trace,1"});
+        REQUIRE(cpu.RestoreCheckpoint("test_cpu.ckpt"));
+        Run(cpu, 1000);
+        Returns own;
+        for (const auto &ret : cpu.returns) {
+            if (ret.second < 0x100) {
+                own.push_back(ret);
+            }
+        }
+        REQUIRE(cpu.returns.size() == 12);
+        // the limit of one still holds with the restored reads returning
+        REQUIRE(own.size() == 4);
+        for (size_t i = 1; i < own.size(); i++) {
+            REQUIRE(own[i].first - own[i - 1].first >= min_latency);
+        }
+    }
+
+    SECTION("TEST a sampled replay still finishes after a restore") {
+        std::ostringstream lines;
+        for (int i = 0; i < 40; i++) {
+            lines << "0x" << std::hex << i * 0x40 << " READ " << std::dec
+                  << i * 10 << "\n";
+        }
+        WriteTrace("test_cpu_long.trace", lines.str());
+        std::unique_ptr<dramsim3::Sampler> sampler(
+            new dramsim3::Sampler(10, 2, 3));
+        RecordingCPU<dramsim3::TraceBasedCPU> cpu(
+            kConfig, ".", "test_cpu_long.trace", false, std::move(sampler));
+        REQUIRE(cpu.RestoreCheckpoint("test_cpu.ckpt"));
+        Run(cpu, 100000);
+        REQUIRE(cpu.Finished());
+        size_t num_restored = 0;
+        for (const auto &ret : cpu.returns) {
+            num_restored += ret.second >= 0x20000000;
+        }
+        REQUIRE(num_restored == 8);
+        std::remove("test_cpu_long.trace");
+    }
+
+    std::remove("test_cpu_warm.trace");
+    std::remove("test_cpu_c.trace");
+    std::remove("test_cpu.ckpt");
+}
+
+TEST_CASE("Sweep CPU Testing", "[cpu][sweep]") {
+    const std::vector<std::string> configs = {
+        "configs/DDR4_8Gb_x8_2400.ini", "configs/DDR4_8Gb_x8_3200.ini"};
+    const std::vector<std::string> names = {"DDR4_8Gb_x8_2400",
+                                            "DDR4_8Gb_x8_3200"};
+    const std::string trace = "tests/example.trace";
+    const uint64_t cycles = 100000;
+
+    // every config of a sweep, on threads or not, ends up with the stats of
+    // a run of its own
+    auto check_sweep = [&](const dramsim3::Sampler *sampler) {
+        for (const std::string dir : {"test_sweep_single", "test_sweep_serial",
+                                      "test_sweep_threads"}) {
+            mkdir(dir.c_str(), 0755);
+        }
+        for (size_t i = 0; i < configs.size(); i++) {
+            std::string dir = "test_sweep_single/" + names[i];
+            mkdir(dir.c_str(), 0755);
+            std::unique_ptr<dramsim3::Sampler> config_sampler;
+            if (sampler) {
+                config_sampler.reset(new dramsim3::Sampler(*sampler));
+            }
+            dramsim3::TraceBasedCPU cpu(configs[i], dir, trace, false,
+                                        std::move(config_sampler));
+            Run(cpu, cycles);
+            cpu.PrintStats();
+        }
+        dramsim3::SweepCPU serial(configs, "test_sweep_serial", trace, false,
+                                  sampler, false);
+        serial.Run(cycles);
+        serial.PrintStats();
+        dramsim3::SweepCPU threads(configs, "test_sweep_threads", trace,
+                                   false, sampler, true);
+        threads.Run(cycles);
+        threads.PrintStats();
+
+        for (const auto &name : names) {
+            for (const char *file : kStatsFiles) {
+                std::string single =
+                    ReadFile("test_sweep_single/" + name + "/" + file);
+                REQUIRE(!single.empty());
+                REQUIRE(ReadFile("test_sweep_serial/" + name + "/" + file) ==
+                        single);
+                REQUIRE(ReadFile("test_sweep_threads/" + name + "/" + file) ==
+                        single);
+            }
+        }
+        for (const std::string dir : {"test_sweep_single", "test_sweep_serial",
+                                      "test_sweep_threads"}) {
+            for (const auto &name : names) {
+                RemoveOutputs(dir + "/" + name);
+            }
+            std::remove(dir.c_str());
+        }
+    };
+
+    SECTION("TEST detailed") { check_sweep(nullptr); }
+
+    SECTION("TEST sampled") {
+        dramsim3::Sampler sampler(1000, 100, 50);
+        check_sweep(&sampler);
+    }
+}
@@ -1,6 +1,16 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+#include "burst_traffic.h"
 #include "catch.hpp"
 #include "configuration.h"
 #include "dram_system.h"
+#include "memory_system.h"
 
 bool call_back_called = false;
 void dummy_call_back(uint64_t addr) {
@@ -15,7 +25,7 @@ TEST_CASE("Jedec DRAMSystem Testing", "[dramsim3]") {
                                       dummy_call_back);
 
     SECTION("TEST interaction with controller") {
-        dramsys.AddTransaction(1, false);
+        dramsys.AddTransaction(1, false, 0);
         int clk = 0;
         while (true) {
             dramsys.ClockTick();
@@ -30,3 +40,290 @@ TEST_CASE("Jedec DRAMSystem Testing", "[dramsim3]") {
         REQUIRE(clk == tRC);
     }
 }
+
+// moves a system from clk towards target and returns where it got to
+using TickStrategy = std::function<uint64_t(dramsim3::JedecDRAMSystem &,
+                                            uint64_t clk, uint64_t target)>;
+
+uint64_t TickEveryCycle(dramsim3::JedecDRAMSystem &sys, uint64_t clk,
+                        uint64_t target) {
+    sys.ClockTick();
+    return clk + 1;
+}
+
+// drive a system with BurstTraffic, return the (cycle, address) of each
+// callback
+std::vector<std::pair<uint64_t, uint64_t>> RunBursts(
+    dramsim3::Config &config, uint64_t cycles = 20000,
+    const TickStrategy &tick = TickEveryCycle) {
+    std::vector<std::pair<uint64_t, uint64_t>> returns;
+    dramsim3::JedecDRAMSystem *sys = nullptr;
+    auto callback = [&](uint64_t addr) {
+        returns.emplace_back(sys->GetClk(), addr);
+    };
+    dramsim3::JedecDRAMSystem dramsys(config, ".", callback, callback);
+    sys = &dramsys;
+    BurstTraffic traffic;
+    DriveBursts(dramsys, traffic, 0, cycles,
+                [&](uint64_t clk, uint64_t target) {
+                    return tick(dramsys, clk, target);
+                });
+    return returns;
+}
+
+// the final per channel stats (dramsim3.json) of a cycle by cycle run of the
+// BurstTraffic of cycles [from, to), written to prefix.json
+std::string RunBurstsStats(dramsim3::Config &config, const std::string &prefix,
+                           uint64_t from, uint64_t to) {
+    config.output_prefix = prefix;
+    config.json_stats_name = prefix + ".json";
+    config.txt_stats_name = prefix + ".txt";
+    config.json_epoch_name = prefix + "epoch.jsonl";
+    {
+        dramsim3::JedecDRAMSystem dramsys(config, ".", nullptr, nullptr);
+        BurstTraffic traffic;
+        DriveBursts(dramsys, traffic, from, to,
+                    [&](uint64_t clk, uint64_t target) {
+                        return TickEveryCycle(dramsys, clk, target);
+                    });
+        dramsys.PrintStats();
+    }
+    std::ifstream in(config.json_stats_name);
+    std::string stats((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    for (const char *suffix : {".json", ".txt", "epoch.jsonl"}) {
+        std::remove((prefix + suffix).c_str());
+    }
+    return stats;
+}
+
+TEST_CASE("Event driven DRAMSystem Testing", "[dramsim3]") {
+    dramsim3::Config cycle_config("configs/HBM1_4Gb_x128.ini", ".");
+    dramsim3::Config event_config("configs/HBM1_4Gb_x128.ini", ".");
+    event_config.event_driven = true;
+
+    SECTION("TEST same returns as cycle by cycle simulation") {
+        auto cycle_returns = RunBursts(cycle_config);
+        REQUIRE(!cycle_returns.empty());
+        REQUIRE(cycle_returns == RunBursts(event_config));
+    }
+
+    SECTION("TEST same returns with write draining") {
+        dramsim3::Config gddr_config("configs/GDDR5_8Gb_x32.ini", ".");
+        auto cycle_returns = RunBursts(gddr_config, 60000);
+        gddr_config.event_driven = true;
+        REQUIRE(cycle_returns == RunBursts(gddr_config, 60000));
+    }
+
+    SECTION("TEST same stats across self refresh") {
+        // starting in an idle period the ranks enter self refresh before
+        // the first burst wakes them up, the skipped cycles in and out of it
+        // still count in the cycle, power state and refresh stats
+        const uint64_t from = BurstTraffic::kBurstCycles;
+        dramsim3::Config ddr4_config("configs/DDR4_8Gb_x8_2400.ini", ".");
+        ddr4_config.enable_self_refresh = true;
+        REQUIRE(static_cast<uint64_t>(ddr4_config.sref_threshold) <
+                BurstTraffic::kPeriod - from);
+        std::string cycle_stats =
+            RunBurstsStats(ddr4_config, "test_event_cycle", from, 20000);
+        REQUIRE(cycle_stats.find("\"num_srefe_cmds\":0,") ==
+                std::string::npos);
+        ddr4_config.event_driven = true;
+        REQUIRE(cycle_stats ==
+                RunBurstsStats(ddr4_config, "test_event_skip", from, 20000));
+    }
+}
+
+TEST_CASE("Multi-threaded DRAMSystem Testing", "[dramsim3]") {
+    dramsim3::Config serial_config("configs/HBM1_4Gb_x128.ini", ".");
+    dramsim3::Config parallel_config("configs/HBM1_4Gb_x128.ini", ".");
+    parallel_config.num_threads = 4;
+
+    SECTION("TEST same returns as single threaded simulation") {
+        auto serial_returns = RunBursts(serial_config);
+        REQUIRE(!serial_returns.empty());
+        REQUIRE(serial_returns == RunBursts(parallel_config));
+    }
+}
+
+TEST_CASE("Batched MemorySystem Testing", "[dramsim3]") {
+    std::vector<dramsim3::MemoryRequest> requests;
+    uint64_t rand = 1;
+    for (uint64_t i = 0; i < 2000; i++) {
+        rand = rand * 6364136223846793005 + 1442695040888963407;
+        requests.push_back({rand >> 20, (rand >> 60) < 5, i});
+    }
+
+    // one call per transaction through the callbacks
+    std::vector<std::pair<uint64_t, uint64_t>> single_returns;
+    uint64_t clk = 0;
+    auto callback = [&](uint64_t addr) {
+        single_returns.emplace_back(clk, addr);
+    };
+    dramsim3::MemorySystem single("configs/HBM1_4Gb_x128.ini", ".", callback,
+                                  callback);
+    size_t num_added = 0;
+    for (clk = 0; clk < 20000; clk++) {
+        while (num_added < requests.size() &&
+               single.WillAcceptTransaction(requests[num_added].addr,
+                                            requests[num_added].is_write)) {
+            single.AddTransaction(requests[num_added].addr,
+                                  requests[num_added].is_write);
+            num_added++;
+        }
+        single.ClockTick();
+    }
+    REQUIRE(single_returns.size() == requests.size());
+
+    // no callbacks, completions come back through the buffer with their tags
+    std::vector<std::pair<uint64_t, uint64_t>> batch_returns;
+    dramsim3::MemorySystem batch("configs/HBM1_4Gb_x128.ini", ".", nullptr,
+                                 nullptr);
+    std::vector<dramsim3::MemoryRequest> completions(16);
+    std::vector<bool> tag_seen(requests.size(), false);
+    num_added = 0;
+    for (clk = 0; clk < 20000; clk++) {
+        num_added += batch.AddTransactions(requests.data() + num_added,
+                                           requests.size() - num_added);
+        batch.ClockTick();
+        size_t num_done;
+        do {
+            num_done = batch.DrainCompletions(completions.data(),
+                                              completions.size());
+            for (size_t i = 0; i < num_done; i++) {
+                const auto &done = completions[i];
+                REQUIRE(done.tag < requests.size());
+                REQUIRE(!tag_seen[done.tag]);
+                tag_seen[done.tag] = true;
+                REQUIRE(done.addr == requests[done.tag].addr);
+                REQUIRE(done.is_write == requests[done.tag].is_write);
+                batch_returns.emplace_back(clk, done.addr);
+            }
+        } while (num_done == completions.size());
+    }
+    REQUIRE(batch_returns == single_returns);
+}
+
+TEST_CASE("Tagged callback Testing", "[dramsim3]") {
+    dramsim3::MemorySystem memory("configs/HBM1_4Gb_x128.ini", ".",
+                                  dummy_call_back, dummy_call_back);
+    std::vector<std::pair<uint64_t, uint64_t>> reads, writes;
+    memory.RegisterTaggedCallbacks(
+        [&](uint64_t addr, uint64_t tag) { reads.emplace_back(addr, tag); },
+        [&](uint64_t addr, uint64_t tag) { writes.emplace_back(addr, tag); });
+
+    // coalesced reads and a write to the same address
+    memory.AddTransaction(0x1000, false, 7);
+    memory.AddTransaction(0x1000, false, 8);
+    memory.AddTransaction(0x2000, true, 9);
+    memory.AddTransaction(0x2000, false, 10);
+    for (int clk = 0; clk < 200; clk++) {
+        memory.ClockTick();
+    }
+    REQUIRE(!call_back_called);
+    std::sort(reads.begin(), reads.end());
+    REQUIRE(reads == std::vector<std::pair<uint64_t, uint64_t>>(
+                         {{0x1000, 7}, {0x1000, 8}, {0x2000, 10}}));
+    REQUIRE(writes ==
+            std::vector<std::pair<uint64_t, uint64_t>>({{0x2000, 9}}));
+}
+
+// per completion handler reached through the CRTP adapter
+class RecordingSink
+    : public dramsim3::CompletionSinkAdapter<RecordingSink> {
+   public:
+    uint64_t clk = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> returns;
+    void OnCompletion(const dramsim3::MemoryRequest &done) {
+        returns.emplace_back(clk, done.addr);
+    }
+};
+
+TEST_CASE("Completion sink Testing", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    auto callback_returns = RunBursts(config);
+    REQUIRE(!callback_returns.empty());
+
+    // RunBursts' traffic, before_tick(clk) is called before every tick
+    auto drive = [](dramsim3::JedecDRAMSystem &dramsys,
+                    const std::function<void(uint64_t)> &before_tick) {
+        BurstTraffic traffic;
+        DriveBursts(dramsys, traffic, 0, 20000, [&](uint64_t clk, uint64_t) {
+            before_tick(clk);
+            dramsys.ClockTick();
+            return clk + 1;
+        });
+    };
+
+    SECTION("CRTP sink sees what the callbacks see") {
+        dramsim3::JedecDRAMSystem dramsys(config, ".", dummy_call_back,
+                                          dummy_call_back);
+        RecordingSink sink;
+        dramsys.RegisterCompletionSink(&sink);
+        drive(dramsys, [&sink](uint64_t clk) { sink.clk = clk; });
+        REQUIRE(sink.returns == callback_returns);
+    }
+
+    SECTION("Ring drained from another thread") {
+        dramsim3::JedecDRAMSystem dramsys(config, ".", dummy_call_back,
+                                          dummy_call_back);
+        // small enough to fill up and make the simulation wait
+        dramsim3::CompletionRing ring(8);
+        dramsys.RegisterCompletionSink(&ring);
+        std::atomic<bool> done(false);
+        std::vector<uint64_t> addrs;
+        std::thread host([&]() {
+            dramsim3::MemoryRequest buf[4];
+            while (true) {
+                bool finished = done.load();
+                size_t num = ring.Drain(buf, 4);
+                for (size_t i = 0; i < num; i++) {
+                    addrs.push_back(buf[i].addr);
+                }
+                if (num == 0 && finished) {
+                    break;
+                }
+            }
+        });
+        drive(dramsys, [](uint64_t clk) {});
+        done.store(true);
+        host.join();
+        REQUIRE(addrs.size() == callback_returns.size());
+        for (size_t i = 0; i < addrs.size(); i++) {
+            REQUIRE(addrs[i] == callback_returns[i].second);
+        }
+    }
+}
+
+TEST_CASE("ClockTickUntil Testing", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    auto tick_returns = RunBursts(config);
+    REQUIRE(!tick_returns.empty());
+    // straight to the next burst through the idle periods
+    int early_stops = 0;
+    auto tick_until = [&early_stops](dramsim3::JedecDRAMSystem &sys,
+                                     uint64_t clk, uint64_t target) {
+        uint64_t reached = sys.ClockTickUntil(target);
+        if (reached < target) {
+            early_stops++;
+        }
+        return reached;
+    };
+
+    SECTION("TEST same returns as ticking every cycle") {
+        REQUIRE(tick_returns == RunBursts(config, 20000, tick_until));
+        // the drain after each burst stops at every completion
+        REQUIRE(early_stops > 0);
+    }
+
+    SECTION("TEST same returns in event driven mode") {
+        config.event_driven = true;
+        REQUIRE(tick_returns == RunBursts(config, 20000, tick_until));
+    }
+
+    SECTION("TEST skipping through refreshes") {
+        dramsim3::Config gddr_config("configs/GDDR5_8Gb_x32.ini", ".");
+        auto gddr_returns = RunBursts(gddr_config, 60000);
+        REQUIRE(gddr_returns == RunBursts(gddr_config, 60000, tick_until));
+    }
+}
@@ -0,0 +1,41 @@
+#include "catch.hpp"
+#include "histogram.h"
+
+TEST_CASE("Histogram Testing", "[histogram]") {
+    SECTION("Linear layout with overflow") {
+        dramsim3::Histogram histo(dramsim3::HistoLayout::LINEAR, 100, 0);
+        for (int i = 1; i <= 100; i++) {
+            histo.AddValue(i);
+        }
+        histo.AddValue(1000);
+        REQUIRE(histo.Count() == 101);
+        REQUIRE(histo.Max() == 1000);
+        REQUIRE(histo.Mean() == Approx(6050.0 / 101));
+        REQUIRE(histo.Percentile(0.5) == 51);
+        REQUIRE(histo.Percentile(0.99) == 100);
+        REQUIRE(histo.Percentile(1.0) == 1000);
+    }
+
+    SECTION("Log linear layout") {
+        dramsim3::Histogram histo(dramsim3::HistoLayout::LOG_LINEAR, 1 << 20,
+                                  7);
+        for (int i = 0; i < 1000; i++) {
+            histo.AddValue(i < 990 ? 200 : 5000 + i);
+        }
+        REQUIRE(histo.Percentile(0.5) == 200);
+        REQUIRE(histo.Percentile(0.99) == 200);
+        int p999 = histo.Percentile(0.999);
+        REQUIRE(p999 >= 5998);
+        REQUIRE(p999 <= 5998 + 5998 / 128);
+
+        dramsim3::Histogram total(dramsim3::HistoLayout::LOG_LINEAR, 1 << 20,
+                                  7);
+        total.Add(histo);
+        total.Add(histo);
+        REQUIRE(total.Count() == 2000);
+        REQUIRE(total.Mean() == Approx(histo.Mean()));
+        total.Clear();
+        REQUIRE(total.Count() == 0);
+        REQUIRE(total.Percentile(0.5) == 0);
+    }
+}
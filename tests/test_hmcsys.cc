@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <vector>
 #include "catch.hpp"
 #include "configuration.h"
 #include "memory_system.h"
@@ -39,3 +41,34 @@ TEST_CASE("HMC System Testing", "[dramsim3][hmc]") {
         REQUIRE(clk == idle_lat);
     }
 }
+
+TEST_CASE("HMC tagged callback Testing", "[dramsim3][hmc]") {
+    dramsim3::MemorySystem hmc("configs/HMC_2GB_4Lx16.ini", ".", hmc_callback,
+                               hmc_callback);
+    std::vector<uint64_t> read_tags, write_tags;
+    hmc.RegisterTaggedCallbacks(
+        [&](uint64_t addr, uint64_t tag) {
+            REQUIRE(addr == 0x40);
+            read_tags.push_back(tag);
+        },
+        [&](uint64_t addr, uint64_t tag) {
+            REQUIRE(addr == 0x40);
+            write_tags.push_back(tag);
+        });
+
+    // requests to one address each come back once with their own tag
+    hmc_called = false;
+    uint64_t tag = 0;
+    for (int clk = 0; clk < 2000; clk++) {
+        if (tag < 8 && hmc.WillAcceptTransaction(0x40, tag % 3 == 0)) {
+            hmc.AddTransaction(0x40, tag % 3 == 0, 100 + tag);
+            tag++;
+        }
+        hmc.ClockTick();
+    }
+    REQUIRE(!hmc_called);
+    std::sort(read_tags.begin(), read_tags.end());
+    std::sort(write_tags.begin(), write_tags.end());
+    REQUIRE(read_tags == std::vector<uint64_t>({101, 102, 104, 105, 107}));
+    REQUIRE(write_tags == std::vector<uint64_t>({100, 103, 106}));
+}
@@ -0,0 +1,62 @@
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+#include "profiler.h"
+
+namespace {
+
+std::map<std::string, double> StatsByName() {
+    std::map<std::string, double> stats;
+    for (const auto &stat : dramsim3::ProfileStats()) {
+        stats[stat.name] = stat.value;
+    }
+    return stats;
+}
+
+}  // namespace
+
+TEST_CASE("Profiler Testing", "[profiler]") {
+    using dramsim3::ProfilePhase;
+    using dramsim3::ProfileTimer;
+
+    SECTION("TEST every phase reported") {
+        auto stats = StatsByName();
+        REQUIRE(stats.count("wall_seconds") == 1);
+        for (const std::string name :
+             {"tick", "get_command_to_issue", "update_timing",
+              "schedule_transaction", "stats", "callbacks"}) {
+            REQUIRE(stats.count(name + "_calls") == 1);
+            REQUIRE(stats.count(name + "_seconds") == 1);
+            REQUIRE(stats.count(name + "_share") == 1);
+        }
+    }
+
+    SECTION("TEST calls counted on this thread") {
+        double before = StatsByName()["update_timing_calls"];
+        for (int i = 0; i < 100; i++) {
+            ProfileTimer timer(ProfilePhase::UPDATE_TIMING);
+        }
+        auto stats = StatsByName();
+        REQUIRE(stats["update_timing_calls"] == before + 100);
+        REQUIRE(stats["update_timing_seconds"] >= 0.0);
+        REQUIRE(stats["update_timing_seconds"] <= stats["wall_seconds"]);
+    }
+
+    SECTION("TEST calls of finished threads kept") {
+        double before = StatsByName()["callbacks_calls"];
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([] {
+                for (int i = 0; i < 50; i++) {
+                    ProfileTimer timer(ProfilePhase::CALLBACKS);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        REQUIRE(StatsByName()["callbacks_calls"] == before + 200);
+    }
+}
@@ -0,0 +1,150 @@
+#include <cmath>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "configuration.h"
+#include "dram_system.h"
+#include "sampling.h"
+
+namespace {
+
+double StatValue(const std::vector<dramsim3::HostStat> &stats,
+                 const std::string &name) {
+    for (const auto &stat : stats) {
+        if (stat.name == name) {
+            return stat.value;
+        }
+    }
+    return -1.0;
+}
+
+// tick until the callback has been called returns times, the cycles taken
+uint64_t TickUntilReturns(dramsim3::JedecDRAMSystem &dramsys, int &returns,
+                          int expected) {
+    uint64_t cycles = 0;
+    while (returns < expected && cycles < 100000) {
+        dramsys.ClockTick();
+        cycles++;
+    }
+    return cycles;
+}
+
+}  // namespace
+
+TEST_CASE("Sampler Testing", "[dramsim3][sampling]") {
+    dramsim3::Sampler sampler(10, 2, 3);
+
+    SECTION("TEST phases") {
+        using Phase = dramsim3::Sampler::Phase;
+        for (uint64_t i = 0; i < 5; i++) {
+            REQUIRE(sampler.PhaseOf(i) == Phase::FUNCTIONAL);
+            REQUIRE(sampler.PhaseOf(i + 10) == Phase::FUNCTIONAL);
+        }
+        REQUIRE(sampler.PhaseOf(5) == Phase::WARMUP);
+        REQUIRE(sampler.PhaseOf(7) == Phase::WARMUP);
+        REQUIRE(sampler.PhaseOf(8) == Phase::MEASURE);
+        REQUIRE(sampler.PhaseOf(19) == Phase::MEASURE);
+    }
+
+    SECTION("TEST means and confidence intervals") {
+        // nothing measured yet, nothing to report
+        sampler.CloseWindow();
+        REQUIRE(sampler.NumSamples() == 0);
+        auto stats = sampler.Stats(64, 1.0);
+        REQUIRE(std::isnan(StatValue(stats, "sampled_read_latency")));
+
+        // 1 transaction in 10 cycles with latency 10
+        sampler.Issued(0);
+        sampler.Completed(false, 10, 9);
+        sampler.CloseWindow();
+        stats = sampler.Stats(64, 1.0);
+        REQUIRE(StatValue(stats, "sampled_read_latency") == Approx(10.0));
+        REQUIRE(std::isnan(StatValue(stats, "sampled_read_latency_ci95")));
+
+        // 1 read and 1 write in 20 cycles, read latency 20
+        sampler.Issued(100);
+        sampler.Issued(101);
+        sampler.Completed(true, 12, 113);
+        sampler.Completed(false, 20, 119);
+        sampler.CloseWindow();
+        REQUIRE(sampler.NumSamples() == 2);
+        stats = sampler.Stats(64, 1.0);
+        REQUIRE(StatValue(stats, "sampled_windows") == Approx(2.0));
+        REQUIRE(StatValue(stats, "detailed_fraction") == Approx(0.5));
+        REQUIRE(StatValue(stats, "sampled_read_latency") == Approx(15.0));
+        // t(1) * s / sqrt(2) with s = sqrt(50)
+        REQUIRE(StatValue(stats, "sampled_read_latency_ci95") ==
+                Approx(12.706 * 5.0));
+        // 0.1 and 0.1 transactions per cycle of 64 bytes at 1ns
+        REQUIRE(StatValue(stats, "sampled_bandwidth") == Approx(6.4));
+        REQUIRE(StatValue(stats, "sampled_bandwidth_ci95") == Approx(0.0));
+    }
+
+    SECTION("TEST windows of different lengths weigh by their size") {
+        // 1 read of latency 100 in 10 cycles
+        sampler.Issued(0);
+        sampler.Completed(false, 100, 9);
+        sampler.CloseWindow();
+        // 11 transactions in 200 cycles, 4 of them reads of latency 10
+        sampler.Issued(1000);
+        for (int i = 0; i < 10; i++) {
+            sampler.Completed(i >= 4, 10, 1100 + i);
+        }
+        sampler.Completed(true, 10, 1199);
+        sampler.CloseWindow();
+        auto stats = sampler.Stats(64, 1.0);
+
+        // totals over totals, not the means of the windows' 0.1 and 0.055
+        // transactions per cycle or 100 and 10 cycles
+        double bandwidth = 12.0 / 210.0;
+        REQUIRE(StatValue(stats, "sampled_bandwidth") ==
+                Approx(64.0 * bandwidth));
+        REQUIRE(StatValue(stats, "sampled_read_latency") == Approx(28.0));
+        // t(1) * s / (sqrt(2) * mean cycles), s of the residuals
+        // done - bandwidth * cycles
+        double r1 = 1.0 - bandwidth * 10.0;
+        double r2 = 11.0 - bandwidth * 200.0;
+        double s = std::sqrt(r1 * r1 + r2 * r2);
+        REQUIRE(StatValue(stats, "sampled_bandwidth_ci95") ==
+                Approx(64.0 * 12.706 * s / (std::sqrt(2.0) * 105.0)));
+        // residuals 100 - 28 and 40 - 4 * 28 over the mean of 2.5 reads
+        s = std::sqrt(72.0 * 72.0 + 72.0 * 72.0);
+        REQUIRE(StatValue(stats, "sampled_read_latency_ci95") ==
+                Approx(12.706 * s / (std::sqrt(2.0) * 2.5)));
+    }
+}
+
+TEST_CASE("Functional fast-forward Testing", "[dramsim3][sampling]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    int returns = 0;
+    auto callback = [&](uint64_t addr) { returns++; };
+    dramsim3::JedecDRAMSystem dramsys(config, ".", callback, callback);
+    int row_miss = config.tRCDRD + config.CL + config.BL;
+
+    SECTION("TEST skipping ahead across refreshes") {
+        dramsys.AddTransaction(0x1000, false, 0);
+        TickUntilReturns(dramsys, returns, 1);
+        uint64_t target = dramsys.GetClk() + 10 * config.tREFI + 17;
+        dramsys.FunctionalSkip(target);
+        REQUIRE(dramsys.GetClk() == target);
+        REQUIRE(returns == 1);
+
+        // the system carries on in detail from there
+        for (uint64_t i = 0; i < 32; i++) {
+            dramsys.AddTransaction(i << 12, i % 2 == 0, 0);
+        }
+        TickUntilReturns(dramsys, returns, 33);
+        REQUIRE(returns == 33);
+    }
+
+    SECTION("TEST functional accesses leave rows open") {
+        dramsys.FunctionalSkip(1000);
+        dramsys.FunctionalAccess(0x1000, false);
+        REQUIRE(dramsys.GetClk() == 1000);
+        REQUIRE(returns == 0);
+        dramsys.AddTransaction(0x1000, false, 0);
+        uint64_t cycles = TickUntilReturns(dramsys, returns, 1);
+        REQUIRE(returns == 1);
+        REQUIRE(cycles < static_cast<uint64_t>(row_miss));
+    }
+}
@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "column_writer.h"
+#include "configuration.h"
+#include "dram_system.h"
+#include "json.hpp"
+#include "stats_writer.h"
+
+namespace {
+
+std::vector<std::string> ReadLines(const std::string &file) {
+    std::vector<std::string> lines;
+    std::ifstream in(file);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+uint64_t GetLE(const std::string &bytes, size_t pos, int num_bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < num_bytes; i++) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[pos + i]))
+                 << (8 * i);
+    }
+    return value;
+}
+
+}  // namespace
+
+TEST_CASE("Stats writer Testing", "[stats]") {
+    const std::string file = "test_stats_writer.jsonl";
+
+    SECTION("TEST nothing written, no file") {
+        std::remove(file.c_str());
+        { dramsim3::StatsWriter writer(file); }
+        REQUIRE(!std::ifstream(file));
+    }
+
+    SECTION("TEST lines across many hand overs") {
+        // enough to fill several buffers
+        const int num_lines = 100000;
+        {
+            dramsim3::StatsWriter writer(file);
+            for (int i = 0; i < num_lines; i++) {
+                writer.WriteLine("{\"line\":" + std::to_string(i) + "}");
+                if (i == num_lines / 2) {
+                    writer.Flush();
+                    REQUIRE(ReadLines(file).size() == num_lines / 2 + 1);
+                }
+            }
+        }
+        auto lines = ReadLines(file);
+        REQUIRE(lines.size() == num_lines);
+        for (int i = 0; i < num_lines; i++) {
+            REQUIRE(nlohmann::json::parse(lines[i])["line"] == i);
+        }
+    }
+    std::remove(file.c_str());
+}
+
+TEST_CASE("Epoch stats output Testing", "[stats]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    config.epoch_period = 1000;
+    config.epoch_json = true;
+    config.epoch_columnar = true;
+    config.json_epoch_name = "test_epoch.jsonl";
+    config.columnar_epoch_name = "test_epoch.bin";
+    config.json_stats_name = "test_epoch_final.json";
+    config.txt_stats_name = "test_epoch_final.txt";
+    {
+        dramsim3::JedecDRAMSystem dramsys(config, ".", nullptr, nullptr);
+        for (uint64_t clk = 0; clk < 10500; clk++) {
+            if (clk % 7 == 0) {
+                uint64_t addr = clk * 0x9E3779B97F4A7C15ull >> 24;
+                if (dramsys.WillAcceptTransaction(addr, false)) {
+                    dramsys.AddTransaction(addr, false, 0);
+                }
+            }
+            dramsys.ClockTick();
+        }
+        dramsys.PrintStats();
+
+        // complete by the time PrintStats returns, a line per epoch and
+        // channel in epoch order
+        auto lines = ReadLines(config.json_epoch_name);
+        REQUIRE(lines.size() == 10u * config.channels);
+        for (size_t i = 0; i < lines.size(); i++) {
+            auto j_epoch = nlohmann::json::parse(lines[i]);
+            REQUIRE(j_epoch["epoch_num"] == i / config.channels + 1);
+            REQUIRE(j_epoch["channel"] == i % config.channels);
+        }
+
+        // the same stats in columns, where the 6 per rank stats that are
+        // objects in the JSON take a column per rank
+        std::ifstream in(config.columnar_epoch_name, std::ifstream::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)),
+                          std::istreambuf_iterator<char>());
+        REQUIRE(bytes.size() > 16);
+        uint64_t num_columns = GetLE(bytes, 12, 4);
+        REQUIRE(num_columns == nlohmann::json::parse(lines[0]).size() +
+                                   6 * (config.ranks - 1));
+    }
+    std::remove("test_epoch.jsonl");
+    std::remove("test_epoch.bin");
+    std::remove("test_epoch_final.json");
+    std::remove("test_epoch_final.txt");
+}
+
+TEST_CASE("Columnar epoch stats Testing", "[stats]") {
+    const std::string file = "test_columns.bin";
+    // two full blocks and a short one
+    const uint64_t num_rows = 2500;
+    {
+        dramsim3::ColumnWriter writer(file);
+        REQUIRE(!writer.HasSchema());
+        writer.SetSchema({{"count", dramsim3::ColumnType::UINT64},
+                          {"value", dramsim3::ColumnType::DOUBLE}});
+        for (uint64_t i = 0; i < num_rows; i++) {
+            double value = i * 0.5;
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            writer.AddRow({i, bits});
+        }
+    }
+    std::ifstream in(file, std::ifstream::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    REQUIRE(bytes.compare(0, dramsim3::kColumnMagicSize,
+                          std::string(dramsim3::kColumnMagic,
+                                      dramsim3::kColumnMagicSize)) == 0);
+    REQUIRE(GetLE(bytes, 8, 4) == dramsim3::kColumnVersion);
+    REQUIRE(GetLE(bytes, 12, 4) == 2);
+    size_t pos = 16;
+    for (const std::string name : {"count", "value"}) {
+        pos += 2;
+        REQUIRE(GetLE(bytes, pos, 2) == name.size());
+        REQUIRE(bytes.substr(pos + 2, name.size()) == name);
+        pos += 2 + name.size();
+    }
+    REQUIRE(GetLE(bytes, 16, 1) == 0);
+    REQUIRE(GetLE(bytes, 16 + 4 + 5, 1) == 2);
+
+    uint64_t row = 0;
+    while (pos < bytes.size()) {
+        uint64_t block_rows = GetLE(bytes, pos, 4);
+        pos += 8;
+        REQUIRE(block_rows > 0);
+        for (uint64_t i = 0; i < block_rows; i++) {
+            REQUIRE(GetLE(bytes, pos + 8 * i, 8) == row + i);
+            uint64_t bits = GetLE(bytes, pos + 8 * (block_rows + i), 8);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            REQUIRE(value == (row + i) * 0.5);
+        }
+        pos += 16 * block_rows;
+        row += block_rows;
+    }
+    REQUIRE(pos == bytes.size());
+    REQUIRE(row == num_rows);
+    std::remove(file.c_str());
+}
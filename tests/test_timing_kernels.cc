@@ -0,0 +1,75 @@
+#include <random>
+#include <vector>
+#include "catch.hpp"
+#include "timing_kernels.h"
+
+namespace {
+
+// kernel must update the first lanes slots of each row exactly like the
+// scalar full row kernel and leave the others alone
+void CheckKernel(dramsim3::MaxRowsKernel kernel, int lanes) {
+    std::mt19937_64 gen(42);
+    for (size_t num_rows = 0; num_rows < 20; num_rows++) {
+        // small values collide often, the top bit exercises unsigned compares
+        std::vector<uint64_t> dst(num_rows * dramsim3::kTimingRowSize);
+        std::vector<uint64_t> row(dramsim3::kTimingRowSize);
+        for (auto& v : dst) {
+            v = gen() % 3 == 0 ? gen() : gen() % 16;
+        }
+        for (auto& v : row) {
+            v = gen() % 3 == 0 ? gen() : gen() % 16;
+        }
+        std::vector<uint64_t> expected = dst;
+        dramsim3::MaxRowsScalar<dramsim3::kTimingRowSize>(
+            expected.data(), num_rows, row.data());
+        kernel(dst.data(), num_rows, row.data());
+        for (size_t i = 0; i < dst.size(); i++) {
+            if (static_cast<int>(i % dramsim3::kTimingRowSize) >= lanes) {
+                expected[i] = dst[i];
+            }
+        }
+        REQUIRE(dst == expected);
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Timing kernel Testing", "[timing]") {
+    SECTION("Scalar kernel") {
+        uint64_t dst[dramsim3::kTimingRowSize * 2] = {0};
+        uint64_t row[dramsim3::kTimingRowSize] = {0};
+        row[3] = 10;
+        row[4] = 10;
+        dst[3] = 20;
+        dst[dramsim3::kTimingRowSize + 5] = ~0ULL;
+        dramsim3::MaxRowsScalar<4>(dst, 2, row);
+        REQUIRE(dst[3] == 20);
+        REQUIRE(dst[dramsim3::kTimingRowSize + 3] == 10);
+        REQUIRE(dst[dramsim3::kTimingRowSize + 4] == 0);
+        REQUIRE(dst[dramsim3::kTimingRowSize + 5] == ~0ULL);
+    }
+
+    SECTION("Selected kernels match scalar") {
+        for (int lanes = 0; lanes <= dramsim3::kTimingRowSize; lanes++) {
+            CheckKernel(dramsim3::SelectMaxRowsKernel(lanes), lanes);
+        }
+    }
+
+#ifdef DRAMSIM3_X86_KERNELS
+    SECTION("SSE4.2 kernels match scalar") {
+        if (__builtin_cpu_supports("sse4.2")) {
+            CheckKernel(dramsim3::MaxRowsSSE42<4>, 4);
+            CheckKernel(dramsim3::MaxRowsSSE42<12>, 12);
+            CheckKernel(dramsim3::MaxRowsSSE42<16>, 16);
+        }
+    }
+
+    SECTION("AVX2 kernels match scalar") {
+        if (__builtin_cpu_supports("avx2")) {
+            CheckKernel(dramsim3::MaxRowsAVX2<4>, 4);
+            CheckKernel(dramsim3::MaxRowsAVX2<8>, 8);
+            CheckKernel(dramsim3::MaxRowsAVX2<16>, 16);
+        }
+    }
+#endif
+}
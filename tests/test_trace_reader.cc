@@ -0,0 +1,270 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#ifdef GZIP_TRACE
+#include <zlib.h>
+#endif  // GZIP_TRACE
+#include "catch.hpp"
+#include "spsc_ring.h"
+#include "trace_reader.h"
+
+TEST_CASE("Trace reader Testing", "[trace]") {
+    std::vector<dramsim3::Transaction> expected;
+    auto text_reader = dramsim3::OpenTraceReader("tests/example.trace");
+    dramsim3::Transaction trans;
+    while (text_reader->Next(trans)) {
+        expected.push_back(trans);
+    }
+    REQUIRE(expected.size() > 100);
+    REQUIRE(expected[0].addr == 0x2000D5C0);
+    REQUIRE(!expected[0].is_write);
+    REQUIRE(expected[0].added_cycle == 30);
+    REQUIRE(expected[1].is_write);
+
+    // out of order cycles and large address jumps need negative deltas
+    dramsim3::Transaction odd(~0ULL - 63, true);
+    odd.added_cycle = 5;
+    expected.push_back(odd);
+    odd.addr = 0;
+    odd.added_cycle = 1ULL << 40;
+    expected.push_back(odd);
+
+    const char* bin_file = "test_trace_reader.bin";
+    {
+        std::ofstream out(bin_file, std::ios::binary);
+        dramsim3::BinaryTraceWriter writer(out);
+        for (const auto& t : expected) {
+            writer.Write(t);
+        }
+    }
+    REQUIRE(dramsim3::IsBinaryTrace(bin_file));
+    REQUIRE(!dramsim3::IsBinaryTrace("tests/example.trace"));
+
+    auto bin_reader = dramsim3::OpenTraceReader(bin_file);
+    for (const auto& t : expected) {
+        REQUIRE(bin_reader->Next(trans));
+        REQUIRE(trans.addr == t.addr);
+        REQUIRE(trans.is_write == t.is_write);
+        REQUIRE(trans.added_cycle == t.added_cycle);
+    }
+    REQUIRE(!bin_reader->Next(trans));
+    std::remove(bin_file);
+}
+
+TEST_CASE("Trace dependency marker Testing", "[trace]") {
+    const char* text_file = "test_trace_reader.txt";
+    {
+        std::ofstream out(text_file);
+        out << "0x40 READ 10\n"
+            << "0x80 WRITE 12 DEP\n"
+            << "\n"
+            << "0xC0 READ 20   DEP\n";
+    }
+    auto text_reader = dramsim3::OpenTraceReader(text_file);
+    dramsim3::Transaction trans;
+    bool depends;
+    std::vector<std::pair<dramsim3::Transaction, bool>> records;
+    while (text_reader->Next(trans, depends)) {
+        records.emplace_back(trans, depends);
+    }
+    std::remove(text_file);
+    REQUIRE(records.size() == 3);
+    REQUIRE(!records[0].second);
+    REQUIRE(records[1].first.is_write);
+    REQUIRE(records[1].second);
+    REQUIRE(records[2].first.addr == 0xC0);
+    REQUIRE(records[2].first.added_cycle == 20);
+    REQUIRE(records[2].second);
+
+    SECTION("Binary round trip") {
+        const char* bin_file = "test_trace_reader.bin";
+        {
+            std::ofstream out(bin_file, std::ios::binary);
+            dramsim3::BinaryTraceWriter writer(out);
+            for (const auto& record : records) {
+                writer.Write(record.first, record.second);
+            }
+        }
+        auto bin_reader = dramsim3::OpenTraceReader(bin_file);
+        for (const auto& record : records) {
+            REQUIRE(bin_reader->Next(trans, depends));
+            REQUIRE(trans.addr == record.first.addr);
+            REQUIRE(trans.added_cycle == record.first.added_cycle);
+            REQUIRE(depends == record.second);
+        }
+        REQUIRE(!bin_reader->Next(trans));
+        std::remove(bin_file);
+    }
+
+    SECTION("Version 1 binary traces") {
+        // 0x40 READ 10, 0x80 WRITE 12 with a 1 bit shifted cycle delta
+        const char v1_trace[] = {'D', 'S', '3', 'T', 'R', 'A', 'C', 'E',
+                                 1,   0,   0,   0,   0,   0,   0,   0,
+                                 40,  char(0x80), 1, 9, char(0x80), 1};
+        const char* bin_file = "test_trace_reader.bin";
+        {
+            std::ofstream out(bin_file, std::ios::binary);
+            out.write(v1_trace, sizeof(v1_trace));
+        }
+        auto bin_reader = dramsim3::OpenTraceReader(bin_file);
+        REQUIRE(bin_reader->Next(trans, depends));
+        REQUIRE(trans.addr == 0x40);
+        REQUIRE(trans.added_cycle == 10);
+        REQUIRE(!trans.is_write);
+        REQUIRE(!depends);
+        REQUIRE(bin_reader->Next(trans, depends));
+        REQUIRE(trans.addr == 0x80);
+        REQUIRE(trans.added_cycle == 12);
+        REQUIRE(trans.is_write);
+        REQUIRE(!depends);
+        REQUIRE(!bin_reader->Next(trans));
+        std::remove(bin_file);
+    }
+}
+
+TEST_CASE("SPSC ring Testing", "[trace]") {
+    dramsim3::SpscRing<uint64_t> ring(100);
+    REQUIRE(ring.Capacity() == 128);
+    const uint64_t num_items = 1000000;
+    std::thread producer([&ring, num_items]() {
+        for (uint64_t i = 0; i < num_items; i++) {
+            while (!ring.TryPush(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint64_t expected = 0, item;
+    while (expected < num_items) {
+        if (ring.TryPop(item)) {
+            REQUIRE(item == expected);
+            expected++;
+        }
+    }
+    producer.join();
+    REQUIRE(!ring.TryPop(item));
+}
+
+TEST_CASE("Trace fanout Testing", "[trace]") {
+    std::vector<dramsim3::Transaction> expected;
+    auto text_reader = dramsim3::OpenTraceReader("tests/example.trace");
+    dramsim3::Transaction trans;
+    while (text_reader->Next(trans)) {
+        expected.push_back(trans);
+    }
+
+    SECTION("Readers taking turns") {
+        dramsim3::TraceFanout fanout(
+            dramsim3::OpenTraceReader("tests/example.trace"), 2);
+        auto first = fanout.Reader(0);
+        auto second = fanout.Reader(1);
+        // one reader all the way through before the other starts
+        for (auto reader : {first.get(), second.get()}) {
+            for (const auto& t : expected) {
+                REQUIRE(reader->Next(trans));
+                REQUIRE(trans.addr == t.addr);
+                REQUIRE(trans.added_cycle == t.added_cycle);
+            }
+            REQUIRE(!reader->Next(trans));
+            REQUIRE(!reader->Next(trans));
+        }
+    }
+
+    SECTION("Readers on threads at different paces") {
+        // a tight bound on how far ahead a reader gets, and a reader that
+        // gives up early must not hold the others back
+        dramsim3::TraceFanout fanout(
+            dramsim3::OpenTraceReader("tests/example.trace"), 4, 2);
+        std::vector<size_t> counts(4, 0);
+        std::vector<int> in_order(4, 1);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < 4; i++) {
+            threads.emplace_back([&, i]() {
+                auto reader = fanout.Reader(i);
+                dramsim3::Transaction t;
+                while (reader->Next(t)) {
+                    in_order[i] = in_order[i] &&
+                                  t.addr == expected[counts[i]].addr;
+                    counts[i]++;
+                    if (i == 3 && counts[i] == 5000) {
+                        fanout.Release(i);
+                        return;
+                    }
+                    if (counts[i] % (1000 * (i + 1)) == 0) {
+                        std::this_thread::sleep_for(
+                            std::chrono::microseconds(100));
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (size_t i = 0; i < 3; i++) {
+            REQUIRE(in_order[i]);
+            REQUIRE(counts[i] == expected.size());
+        }
+        REQUIRE(in_order[3]);
+        REQUIRE(counts[3] == 5000);
+    }
+}
+
+#ifdef GZIP_TRACE
+TEST_CASE("Streaming trace reader Testing", "[trace]") {
+    std::vector<dramsim3::Transaction> expected;
+    auto text_reader = dramsim3::OpenTraceReader("tests/example.trace");
+    dramsim3::Transaction trans;
+    while (text_reader->Next(trans)) {
+        expected.push_back(trans);
+    }
+
+    // the text trace goes in without its last newline and with a blank line
+    std::ifstream text_file("tests/example.trace");
+    std::stringstream text;
+    text << "\n" << text_file.rdbuf();
+    std::string text_trace = text.str();
+    while (text_trace.back() == '\n') {
+        text_trace.pop_back();
+    }
+    std::stringstream binary;
+    dramsim3::BinaryTraceWriter writer(binary);
+    for (const auto& t : expected) {
+        writer.Write(t);
+    }
+
+    const char* gz_file = "test_trace_reader.gz";
+    for (const auto& trace : {text_trace, binary.str()}) {
+        gzFile out = gzopen(gz_file, "wb");
+        REQUIRE(gzwrite(out, trace.data(), trace.size()) ==
+                static_cast<int>(trace.size()));
+        gzclose(out);
+        REQUIRE(dramsim3::GetTraceCompression(gz_file) ==
+                dramsim3::TraceCompression::GZIP);
+
+        auto reader = dramsim3::OpenTraceReader(gz_file);
+        for (const auto& t : expected) {
+            REQUIRE(reader->Next(trans));
+            REQUIRE(trans.addr == t.addr);
+            REQUIRE(trans.is_write == t.is_write);
+            REQUIRE(trans.added_cycle == t.added_cycle);
+        }
+        REQUIRE(!reader->Next(trans));
+    }
+
+    // stopping early must not hang on a decoder blocked on a full ring
+    gzFile out = gzopen(gz_file, "wb");
+    for (int i = 0; i < 3; i++) {
+        gzwrite(out, text_trace.data(), text_trace.size());
+        gzputc(out, '\n');
+    }
+    gzclose(out);
+    {
+        auto reader = dramsim3::OpenTraceReader(gz_file);
+        REQUIRE(reader->Next(trans));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    std::remove(gz_file);
+}
+#endif  // GZIP_TRACE
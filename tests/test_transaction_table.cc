@@ -0,0 +1,49 @@
+#include <map>
+#include <random>
+#include "catch.hpp"
+#include "transaction_table.h"
+
+TEST_CASE("Transaction Table Testing", "[transaction_table]") {
+    // small expected size so that the table has to grow and probe
+    dramsim3::TransactionTable table(2);
+    std::multimap<uint64_t, uint64_t> ref;  // addr -> added_cycle
+    std::mt19937_64 gen(0);
+
+    for (uint64_t clk = 0; clk < 20000; clk++) {
+        uint64_t addr = (gen() % 64) << 6;
+        switch (gen() % 3) {
+            case 0: {
+                dramsim3::Transaction trans(addr, false);
+                trans.added_cycle = clk;
+                ref.insert(std::make_pair(addr, clk));
+                REQUIRE(table.Insert(trans) == ref.count(addr));
+                break;
+            }
+            case 1:
+                if (table.Contains(addr)) {
+                    REQUIRE(table.Front(addr)->added_cycle ==
+                            ref.find(addr)->second);
+                    table.PopFront(addr);
+                    ref.erase(ref.find(addr));
+                } else {
+                    REQUIRE(ref.count(addr) == 0);
+                    REQUIRE(table.Front(addr) == nullptr);
+                }
+                break;
+            case 2: {
+                auto range = ref.equal_range(addr);
+                auto it = range.first;
+                auto num = table.Drain(addr, [&](dramsim3::Transaction& t) {
+                    REQUIRE(it != range.second);
+                    REQUIRE(t.added_cycle == it->second);
+                    ++it;
+                });
+                REQUIRE(it == range.second);
+                REQUIRE(num == ref.count(addr));
+                ref.erase(addr);
+                break;
+            }
+        }
+        REQUIRE(table.Size() == ref.size());
+    }
+}